@@ -0,0 +1,142 @@
+/*
+
+Replaces the global operator new and delete to count allocations.
+Linked into every benchmark by event_manager_benchmark().
+
+Every block starts with a header holding its requested size, so that frees can be accounted
+for without relying on sized deallocation.
+
+*/
+
+#include "Allocations.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+#if defined(_MSC_VER)
+	#include <malloc.h>
+#elif defined(__GLIBC__)
+	#include <malloc.h>
+	#define BENCH_USABLE_SIZE(memory) malloc_usable_size(memory)
+#endif
+
+namespace
+{
+
+std::atomic<uint64_t>	g_count;
+std::atomic<uint64_t>	g_bytes;
+std::atomic<uint64_t>	g_frees;
+std::atomic<int64_t>	g_live;
+std::atomic<int64_t>	g_reserved;
+
+constexpr std::size_t HeaderSize = alignof(std::max_align_t);
+
+// Distance from the start of the block to the memory handed out
+inline std::size_t offsetFor(std::size_t alignment)
+{
+	return std::max(alignment, HeaderSize);
+}
+
+inline void* allocate(std::size_t size, std::size_t alignment)
+{
+	auto offset = offsetFor(alignment);
+	auto total  = size + offset;
+
+#if defined(_MSC_VER)
+	void* block = _aligned_malloc(total, offset);
+#else
+	void* block = alignment > alignof(std::max_align_t)
+		? std::aligned_alloc(offset, (total + offset - 1) / offset * offset)
+		: std::malloc(total);
+#endif
+
+	if (!block)
+		throw std::bad_alloc();
+
+	auto memory = static_cast<unsigned char*>(block) + offset;
+	reinterpret_cast<std::size_t*>(memory)[-1] = size;
+
+	g_count.fetch_add(1, std::memory_order_relaxed);
+	g_bytes.fetch_add(size, std::memory_order_relaxed);
+	g_live.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+
+#ifdef BENCH_USABLE_SIZE
+	g_reserved.fetch_add(static_cast<int64_t>(BENCH_USABLE_SIZE(block) - offset), std::memory_order_relaxed);
+#endif
+
+	return memory;
+}
+
+inline void release(void* memory, std::size_t alignment)
+{
+	if (!memory)
+		return;
+
+	auto offset	= offsetFor(alignment);
+	auto size	= reinterpret_cast<std::size_t*>(memory)[-1];
+	auto block	= static_cast<unsigned char*>(memory) - offset;
+
+	g_frees.fetch_add(1, std::memory_order_relaxed);
+	g_live.fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+
+#ifdef BENCH_USABLE_SIZE
+	g_reserved.fetch_sub(static_cast<int64_t>(BENCH_USABLE_SIZE(block) - offset), std::memory_order_relaxed);
+#endif
+
+#if defined(_MSC_VER)
+	_aligned_free(block);
+#else
+	std::free(block);
+#endif
+}
+
+} // namespace
+
+namespace bench
+{
+
+Allocations allocations()
+{
+	return {
+		g_count.load(std::memory_order_relaxed),
+		g_bytes.load(std::memory_order_relaxed),
+		g_frees.load(std::memory_order_relaxed),
+		g_live.load(std::memory_order_relaxed),
+		g_reserved.load(std::memory_order_relaxed)
+	};
+}
+
+} // namespace bench
+
+void* operator new(std::size_t size)
+{
+	return allocate(size, alignof(std::max_align_t));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment)
+{
+	return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory) noexcept
+{
+	release(memory, alignof(std::max_align_t));
+}
+
+void operator delete(void* memory, std::size_t) noexcept
+{
+	release(memory, alignof(std::max_align_t));
+}
+
+void operator delete(void* memory, std::align_val_t alignment) noexcept
+{
+	release(memory, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t alignment) noexcept
+{
+	release(memory, static_cast<std::size_t>(alignment));
+}
@@ -0,0 +1,37 @@
+/*
+
+Global allocation counters for the EventManager benchmarks, see Allocations.cpp
+
+*/
+
+#pragma once
+
+#include <cstdint>
+
+namespace bench
+{
+
+struct Allocations
+{
+	uint64_t	count{};	// operator new calls
+	uint64_t	bytes{};	// bytes requested
+	uint64_t	frees{};	// operator delete calls
+	int64_t		live{};		// bytes requested and not freed yet
+	int64_t		reserved{};	// live bytes as reserved by malloc, including its rounding; 0 where unknown
+
+	constexpr Allocations operator - (Allocations const& other) const
+	{
+		return { count - other.count, bytes - other.bytes, frees - other.frees, live - other.live, reserved - other.reserved };
+	}
+
+	// Allocations not freed yet
+	constexpr int64_t liveCount() const
+	{
+		return static_cast<int64_t>(count) - static_cast<int64_t>(frees);
+	}
+};
+
+// Allocations made by every thread since the start of the program
+Allocations allocations();
+
+} // namespace bench
@@ -0,0 +1,205 @@
+/*
+
+Minimal benchmark harness for the EventManager benchmarks
+
+Every benchmark accepts:
+	--repetitions <n>	timed repetitions per case (default 5)
+	--json <file>		write every result, with the ns/op of each repetition, for bench_compare
+
+*/
+
+#pragma once
+
+#include "Allocations.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+
+// Keep the compiler from discarding a value
+template <typename T>
+inline void doNotOptimize(T const& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+	asm volatile("" : : "r,m"(value) : "memory");
+#else
+	static volatile char const* sink;
+	sink = reinterpret_cast<char const volatile*>(&value);
+#endif
+}
+
+// xorshift64, deterministic across runs and platforms
+class Random
+{
+public:
+	explicit Random(uint64_t seed = 0x9E3779B97F4A7C15ull) :
+		m_state(seed ? seed : 0x9E3779B97F4A7C15ull) { }
+
+	inline uint64_t next()
+	{
+		m_state ^= m_state << 13;
+		m_state ^= m_state >> 7;
+		m_state ^= m_state << 17;
+
+		return m_state;
+	}
+
+	// Uniform in [0, bound)
+	inline uint32_t below(uint32_t bound)
+	{
+		return static_cast<uint32_t>(next() % bound);
+	}
+
+private:
+	uint64_t m_state;
+};
+
+struct Result
+{
+	std::string			name;
+	uint64_t			iterations{};
+	double				nsPerOp{};		// fastest repetition
+	double				allocsPerOp{};
+	std::vector<double>	samples;		// ns/op of every repetition
+};
+
+struct Config
+{
+	int					repetitions = 5;
+	std::string			json;
+	std::vector<Result>	results;
+};
+
+inline Config& config()
+{
+	static Config instance;
+	return instance;
+}
+
+// Consume the harness options, the remaining arguments are left to the benchmark
+inline void init(int& argc, char** argv)
+{
+	auto& c = config();
+
+	int kept = 1;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 < argc && !std::strcmp(argv[i], "--repetitions"))
+			c.repetitions = std::max(std::atoi(argv[++i]), 1);
+
+		else if (i + 1 < argc && !std::strcmp(argv[i], "--json"))
+			c.json = argv[++i];
+
+		else
+			argv[kept++] = argv[i];
+	}
+
+	argc = kept;
+}
+
+inline void report(Result result)
+{
+	config().results.push_back(std::move(result));
+}
+
+inline void writeJson(std::ostream& out, std::vector<Result> const& results)
+{
+	out << "{\n\t\"benchmarks\": [";
+
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		auto& result = results[i];
+
+		out << (i ? ",\n" : "\n") << "\t\t{\"name\": \"";
+
+		for (char c : result.name)
+			out << (c == '"' || c == '\\' ? "\\" : "") << c;
+
+		out << "\", \"iterations\": " << result.iterations
+			<< ", \"nsPerOp\": " << result.nsPerOp
+			<< ", \"allocsPerOp\": " << result.allocsPerOp
+			<< ", \"samples\": [";
+
+		for (size_t j = 0; j < result.samples.size(); j++)
+			out << (j ? ", " : "") << result.samples[j];
+
+		out << "]}";
+	}
+
+	out << "\n\t]\n}\n";
+}
+
+// Write the JSON report if requested, returns the exit code of the benchmark
+inline int finish()
+{
+	auto& c = config();
+
+	if (c.json.empty())
+		return 0;
+
+	std::ofstream out(c.json);
+	out.precision(17);
+
+	writeJson(out, c.results);
+
+	if (!out)
+	{
+		std::fprintf(stderr, "cannot write %s\n", c.json.c_str());
+		return 1;
+	}
+
+	return 0;
+}
+
+// Run body(iterations) once to warm up and then once per repetition,
+// print the fastest ns/op and the allocations per operation over all repetitions
+template <typename Body>
+inline Result run(std::string name, uint64_t iterations, Body&& body)
+{
+	using Clock = std::chrono::steady_clock;
+
+	body(std::max<uint64_t>(iterations / 10, 1));
+
+	int repetitions = config().repetitions;
+
+	Result result{ std::move(name), iterations, std::numeric_limits<double>::max(), 0, {} };
+	result.samples.reserve(static_cast<size_t>(repetitions));
+
+	auto allocated = allocations();
+
+	for (int i = 0; i < repetitions; i++)
+	{
+		auto begin = Clock::now();
+
+		body(iterations);
+
+		auto ns = std::chrono::duration<double, std::nano>(Clock::now() - begin).count() / static_cast<double>(iterations);
+
+		result.samples.push_back(ns);
+		result.nsPerOp = std::min(result.nsPerOp, ns);
+	}
+
+	auto ops = static_cast<double>(iterations) * repetitions;
+
+	result.allocsPerOp = static_cast<double>((allocations() - allocated).count) / ops;
+
+	std::printf("%-48s %12.2f ns/op %10.2f allocs/op\n", result.name.c_str(), result.nsPerOp, result.allocsPerOp);
+
+	report(result);
+
+	return result;
+}
+
+} // namespace bench
@@ -0,0 +1,63 @@
+/*
+
+Event types for the receiver churn benchmark. Instantiating a subscription is expensive to compile,
+so the types are spread over generated translation units of ChunkSize types each (churn_types.cpp.in),
+which register their subscribe functions before main runs.
+
+*/
+
+#pragma once
+
+#include <EventManager/EventManager.hpp>
+
+#include <utility>
+#include <vector>
+
+namespace bench
+{
+
+template <size_t N>
+struct E_Churn : el::EventBase { };
+
+class ChurnReceiver : public el::EventReceiver
+{
+public:
+	template <size_t N>
+	void on(E_Churn<N> const&) { }
+};
+
+using Subscribe = void(*)(ChurnReceiver&);
+
+constexpr size_t ChunkSize = 256;
+
+// Subscribe function of every event type, indexed by type
+inline std::vector<Subscribe>& churnTypes()
+{
+	static std::vector<Subscribe> instance;
+	return instance;
+}
+
+template <size_t N>
+void subscribe(ChurnReceiver& receiver)
+{
+	el::EventManager::get().subscribe(receiver, &ChurnReceiver::on<N>);
+}
+
+template <size_t Chunk>
+struct ChunkRegistrar
+{
+	ChunkRegistrar()
+	{
+		auto& types = churnTypes();
+
+		if (types.size() < (Chunk + 1) * ChunkSize)
+			types.resize((Chunk + 1) * ChunkSize);
+
+		[&]<size_t... I>(std::index_sequence<I...>)
+		{
+			((types[Chunk * ChunkSize + I] = &subscribe<Chunk * ChunkSize + I>), ...);
+		}(std::make_index_sequence<ChunkSize>());
+	}
+};
+
+} // namespace bench
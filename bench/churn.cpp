@@ -0,0 +1,98 @@
+/*
+
+Receiver churn against the number of registered event types: create a receiver, subscribe it to
+a few event types and destroy it, which unsubscribes it from every registered type.
+Prints a scaling curve, ns per receiver lifetime for each number of types and subscriptions.
+
+The largest number of types is set by EVENT_MANAGER_BENCH_CHURN_TYPES at configure time.
+
+*/
+
+#include "ChurnTypes.hpp"
+
+#include "Bench.hpp"
+
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+	bench::init(argc, argv);
+
+	auto& types = bench::churnTypes();
+
+	std::vector<size_t> cardinalities;
+	for (size_t count : { 10, 100, 1'000, 10'000 })
+		if (count <= types.size())
+			cardinalities.push_back(count);
+
+	std::vector<size_t> const subscriptions = { 1, 4, 16 };
+
+	std::printf("%zu event types available\n", types.size());
+
+	// Keeps the first n types registered
+	bench::ChurnReceiver	keeper;
+	size_t					registered = 0;
+
+	std::vector<std::vector<double> > curve;
+
+	for (size_t count : cardinalities)
+	{
+		for (; registered < count; registered++)
+			types[registered](keeper);
+
+		auto& row = curve.emplace_back();
+
+		for (size_t perReceiver : subscriptions)
+		{
+			if (perReceiver > count)
+			{
+				row.push_back(0);
+				continue;
+			}
+
+			// Spread the subscriptions over the registered types
+			size_t stride = count / perReceiver;
+
+			auto result = bench::run("receiver lifetime, " + std::to_string(count) + " types, "
+				+ std::to_string(perReceiver) + " subscriptions", 2'000'000 / count + 1'000,
+				[&](uint64_t n)
+				{
+					for (uint64_t i = 0; i < n; i++)
+					{
+						bench::ChurnReceiver receiver;
+
+						for (size_t j = 0; j < perReceiver; j++)
+							types[j * stride](receiver);
+					}
+				}
+			);
+
+			row.push_back(result.nsPerOp);
+		}
+	}
+
+	std::printf("\nns per receiver lifetime\n%10s", "types");
+
+	for (size_t perReceiver : subscriptions)
+		std::printf(" %12zu subs", perReceiver);
+
+	std::printf("\n");
+
+	for (size_t i = 0; i < curve.size(); i++)
+	{
+		std::printf("%10zu", cardinalities[i]);
+
+		for (double ns : curve[i])
+		{
+			if (ns)
+				std::printf(" %17.1f", ns);
+			else
+				std::printf(" %17s", "-");
+		}
+
+		std::printf("\n");
+	}
+
+	return bench::finish();
+}
@@ -0,0 +1,438 @@
+/*
+
+Compares a benchmark report against a stored baseline, both written with --json.
+
+Usage: bench_compare <baseline.json> <current.json> [--threshold 0.05] [--alpha 0.01] [--gate <substring>]...
+
+A benchmark regresses when its median ns/op grew by more than the threshold and a one-sided
+Mann-Whitney U test on the per-repetition samples says it is slower with p below alpha.
+Only benchmarks whose name contains one of the --gate substrings fail the run (all of them by default),
+the others are reported. The exit code is 1 on a gated regression, 2 on invalid input.
+
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using Samples = std::vector<double>;
+using Report  = std::map<std::string, Samples>;
+
+// Reads the subset of JSON written by bench::writeJson: objects, arrays, strings and numbers
+class Parser
+{
+public:
+	explicit Parser(std::string text) :
+		m_text(std::move(text)) { }
+
+	bool parse(Report& report)
+	{
+		if (!expect('{'))
+			return false;
+
+		while (!peek('}'))
+		{
+			std::string key;
+			if (!string(key) || !expect(':'))
+				return false;
+
+			if (key == "benchmarks")
+			{
+				if (!benchmarks(report))
+					return false;
+			}
+			else if (!skip())
+				return false;
+
+			comma();
+		}
+
+		return true;
+	}
+
+private:
+	std::string	m_text;
+	size_t		m_at{};
+
+	void space()
+	{
+		while (m_at < m_text.size() && std::isspace(static_cast<unsigned char>(m_text[m_at])))
+			m_at++;
+	}
+
+	bool peek(char c)
+	{
+		space();
+
+		if (m_at < m_text.size() && m_text[m_at] == c)
+		{
+			m_at++;
+			return true;
+		}
+
+		return false;
+	}
+
+	bool expect(char c)
+	{
+		return peek(c);
+	}
+
+	void comma()
+	{
+		peek(',');
+	}
+
+	bool string(std::string& out)
+	{
+		if (!expect('"'))
+			return false;
+
+		for (; m_at < m_text.size() && m_text[m_at] != '"'; m_at++)
+		{
+			if (m_text[m_at] == '\\')
+				m_at++;
+
+			out += m_text[m_at];
+		}
+
+		return m_at++ < m_text.size();
+	}
+
+	bool number(double& out)
+	{
+		space();
+
+		char const*	begin	= m_text.c_str() + m_at;
+		char*		end		= nullptr;
+
+		out = std::strtod(begin, &end);
+
+		if (end == begin)
+			return false;
+
+		m_at += static_cast<size_t>(end - begin);
+		return true;
+	}
+
+	bool skip()
+	{
+		space();
+
+		if (m_at >= m_text.size())
+			return false;
+
+		char c = m_text[m_at];
+
+		if (c == '"')
+		{
+			std::string ignored;
+			return string(ignored);
+		}
+
+		if (c == '{' || c == '[')
+		{
+			char close = c == '{' ? '}' : ']';
+			m_at++;
+
+			while (!peek(close))
+			{
+				if (c == '{')
+				{
+					std::string ignored;
+					if (!string(ignored) || !expect(':'))
+						return false;
+				}
+
+				if (!skip())
+					return false;
+
+				comma();
+			}
+
+			return true;
+		}
+
+		double ignored;
+		return number(ignored);
+	}
+
+	bool benchmarks(Report& report)
+	{
+		if (!expect('['))
+			return false;
+
+		while (!peek(']'))
+		{
+			if (!expect('{'))
+				return false;
+
+			std::string	name;
+			Samples		samples;
+
+			while (!peek('}'))
+			{
+				std::string key;
+				if (!string(key) || !expect(':'))
+					return false;
+
+				if (key == "name")
+				{
+					if (!string(name))
+						return false;
+				}
+				else if (key == "samples")
+				{
+					if (!expect('['))
+						return false;
+
+					while (!peek(']'))
+					{
+						double value;
+						if (!number(value))
+							return false;
+
+						samples.push_back(value);
+						comma();
+					}
+				}
+				else if (!skip())
+					return false;
+
+				comma();
+			}
+
+			report[name] = std::move(samples);
+			comma();
+		}
+
+		return true;
+	}
+};
+
+bool load(char const* path, Report& report)
+{
+	std::ifstream in(path);
+	if (!in)
+	{
+		std::fprintf(stderr, "cannot read %s\n", path);
+		return false;
+	}
+
+	std::stringstream text;
+	text << in.rdbuf();
+
+	if (!Parser(text.str()).parse(report))
+	{
+		std::fprintf(stderr, "%s is not a benchmark report\n", path);
+		return false;
+	}
+
+	return true;
+}
+
+double median(Samples samples)
+{
+	std::sort(samples.begin(), samples.end());
+
+	auto n = samples.size();
+	return n % 2 ? samples[n / 2] : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+}
+
+// Probability that U >= u when there are no ties, by counting the arrangements of m and n samples
+double exactTail(size_t m, size_t n, double u)
+{
+	// counts[j][k]: arrangements of i samples of the first group and j of the second with U = k
+	size_t maxU = m * n;
+
+	std::vector<std::vector<double> > counts(n + 1, std::vector<double>(maxU + 1));
+
+	for (size_t j = 0; j <= n; j++)
+		counts[j][0] = 1;
+
+	for (size_t i = 1; i <= m; i++)
+	{
+		std::vector<std::vector<double> > next(n + 1, std::vector<double>(maxU + 1));
+		next[0][0] = 1;
+
+		for (size_t j = 1; j <= n; j++)
+			for (size_t k = 0; k <= i * j; k++)
+				next[j][k] = next[j - 1][k] + (k >= j ? counts[j][k - j] : 0);
+
+		counts = std::move(next);
+	}
+
+	double total = 0, tail = 0;
+
+	for (size_t k = 0; k <= maxU; k++)
+	{
+		total += counts[n][k];
+
+		if (static_cast<double>(k) >= u)
+			tail += counts[n][k];
+	}
+
+	return tail / total;
+}
+
+// One-sided Mann-Whitney U test, p-value of "current is slower than baseline"
+double mannWhitney(Samples const& baseline, Samples const& current)
+{
+	std::vector<std::pair<double, bool> > all;
+
+	for (double value : baseline)
+		all.push_back({ value, false });
+
+	for (double value : current)
+		all.push_back({ value, true });
+
+	std::sort(all.begin(), all.end());
+
+	double	rankSum		= 0;	// ranks of the current samples
+	double	tieTerm		= 0;
+	bool	ties		= false;
+
+	for (size_t i = 0; i < all.size(); )
+	{
+		size_t j = i;
+		while (j < all.size() && all[j].first == all[i].first)
+			j++;
+
+		double rank = (static_cast<double>(i + j) + 1) / 2;	// average of ranks i + 1 .. j
+
+		for (size_t k = i; k < j; k++)
+			if (all[k].second)
+				rankSum += rank;
+
+		auto t = static_cast<double>(j - i);
+
+		tieTerm += t * t * t - t;
+		ties    |= j - i > 1;
+
+		i = j;
+	}
+
+	auto m = current.size();
+	auto n = baseline.size();
+
+	double u = rankSum - static_cast<double>(m * (m + 1)) / 2;
+
+	if (!ties && m <= 50 && n <= 50)
+		return exactTail(m, n, u);
+
+	// Normal approximation with tie and continuity corrections
+	auto	dm		= static_cast<double>(m);
+	auto	dn		= static_cast<double>(n);
+	auto	total	= dm + dn;
+	double	mean	= dm * dn / 2;
+	double	sigma	= std::sqrt(dm * dn / 12 * ((total + 1) - tieTerm / (total * (total - 1))));
+
+	if (sigma == 0)
+		return 1;
+
+	double z = (u - mean - 0.5) / sigma;
+
+	return 0.5 * std::erfc(z / std::sqrt(2.0));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	double						threshold	= 0.05;
+	double						alpha		= 0.01;
+	std::vector<std::string>	gates;
+	std::vector<char const*>	files;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 < argc && !std::strcmp(argv[i], "--threshold"))
+			threshold = std::atof(argv[++i]);
+
+		else if (i + 1 < argc && !std::strcmp(argv[i], "--alpha"))
+			alpha = std::atof(argv[++i]);
+
+		else if (i + 1 < argc && !std::strcmp(argv[i], "--gate"))
+			gates.push_back(argv[++i]);
+
+		else
+			files.push_back(argv[i]);
+	}
+
+	if (files.size() != 2)
+	{
+		std::fprintf(stderr, "usage: bench_compare <baseline.json> <current.json> [--threshold 0.05] [--alpha 0.01] [--gate <substring>]...\n");
+		return 2;
+	}
+
+	Report baseline, current;
+
+	if (!load(files[0], baseline) || !load(files[1], current))
+		return 2;
+
+	auto gated = [&](std::string const& name)
+	{
+		return gates.empty() || std::any_of(gates.begin(), gates.end(),
+			[&](std::string const& gate)
+			{
+				return name.find(gate) != std::string::npos;
+			}
+		);
+	};
+
+	int regressions = 0;
+
+	std::printf("%-48s %12s %12s %9s %9s\n", "benchmark", "baseline", "current", "change", "p");
+
+	for (auto& [name, samples] : current)
+	{
+		auto entry = baseline.find(name);
+
+		if (entry == baseline.end() || entry->second.empty() || samples.empty())
+		{
+			std::printf("%-48s %12s\n", name.c_str(), "new");
+			continue;
+		}
+
+		double before	= median(entry->second);
+		double after	= median(samples);
+		double change	= before > 0 ? after / before - 1 : 0;
+		double p		= mannWhitney(entry->second, samples);
+
+		char const* verdict = "";
+
+		if (change > threshold && p < alpha)
+		{
+			verdict = gated(name) ? "REGRESSION" : "slower";
+			regressions += gated(name);
+		}
+		else if (-change > threshold && mannWhitney(samples, entry->second) < alpha)
+			verdict = "faster";
+
+		std::printf("%-48s %12.2f %12.2f %+8.1f%% %9.4f %s\n", name.c_str(), before, after, change * 100, p, verdict);
+	}
+
+	for (auto& [name, _] : baseline)
+		if (!current.count(name))
+			std::printf("%-48s %12s\n", name.c_str(), "missing");
+
+	if (regressions)
+	{
+		std::printf("%d benchmark(s) regressed by more than %.1f%% (p < %g)\n", regressions, threshold * 100, alpha);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,111 @@
+/*
+
+Memory footprint of the bus, measured with the counting allocator of Allocations.cpp:
+bytes per registered event type, per subscription and per receiver (its m_subsCount entry),
+plus the number of live allocations and the malloc rounding on top of the requested bytes,
+and what stays allocated once every receiver is gone.
+
+Usage: bench_footprint [receivers = 10000]
+
+*/
+
+#include "ChurnTypes.hpp"
+
+#include "Bench.hpp"
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+void row(std::string const& name, uint64_t units, bench::Allocations const& delta)
+{
+	auto perUnit = [&](double value)
+	{
+		return value / static_cast<double>(units);
+	};
+
+	auto live		= static_cast<double>(delta.live);
+	auto liveCount	= static_cast<double>(delta.liveCount());
+
+	std::printf("%-36s %10llu %12.1f %12.2f %12.1f %10.1f %12.2f\n", name.c_str(),
+		static_cast<unsigned long long>(units),
+		perUnit(live),
+		perUnit(liveCount),
+		liveCount > 0 ? live / liveCount : 0.0,
+		delta.reserved && delta.live > 0 ? (static_cast<double>(delta.reserved) / live - 1) * 100 : 0.0,
+		perUnit(static_cast<double>(delta.count)));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench::init(argc, argv);
+
+	size_t receiverCount = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000;
+
+	auto& types = bench::churnTypes();
+
+	size_t typeCount = std::min<size_t>(types.size(), 1'000);
+
+	std::printf("%-36s %10s %12s %12s %12s %10s %12s\n",
+		"scenario", "units", "bytes/unit", "allocs/unit", "avg alloc", "malloc %", "new()/unit");
+
+	// Event types, each with the keeper as its first subscriber
+	bench::ChurnReceiver keeper;
+
+	auto before = bench::allocations();
+
+	for (size_t i = 0; i < typeCount; i++)
+		types[i](keeper);
+
+	auto typesDelta = bench::allocations() - before;
+	row("event type + first subscription", typeCount, typesDelta);
+
+	// Receivers subscribed to K of the registered types
+	std::vector<size_t> const subscriptions = { 1, 4, 16 };
+
+	std::vector<double> perReceiver;
+
+	for (size_t k : subscriptions)
+	{
+		std::vector<std::unique_ptr<bench::ChurnReceiver> > receivers(receiverCount);
+
+		for (auto& receiver : receivers)
+			receiver = std::make_unique<bench::ChurnReceiver>();
+
+		before = bench::allocations();
+
+		for (auto& receiver : receivers)
+			for (size_t j = 0; j < k; j++)
+				types[j](*receiver);
+
+		auto delta = bench::allocations() - before;
+
+		row(std::to_string(receiverCount) + " receivers x " + std::to_string(k) + " subscriptions", receiverCount * k, delta);
+
+		perReceiver.push_back(static_cast<double>(delta.live) / static_cast<double>(receiverCount));
+
+		before = bench::allocations();
+		receivers.clear();
+
+		// Buckets and nodes the containers keep after the receivers are gone
+		auto retained = (bench::allocations() - before).live + delta.live;
+		std::printf("%-36s %10s %12lld bytes\n", "  retained after destroying them", "", static_cast<long long>(retained));
+	}
+
+	// Receivers pay for their m_subsCount entry on the first subscription only
+	double subscription	= (perReceiver.back() - perReceiver.front()) / static_cast<double>(subscriptions.back() - subscriptions.front());
+	double subsCount	= perReceiver.front() - subscription;
+	double type			= static_cast<double>(typesDelta.live) / static_cast<double>(typeCount) - subscription;
+
+	std::printf("\nbytes per subscription                 %8.1f\n", subscription);
+	std::printf("bytes per receiver in m_subsCount      %8.1f\n", subsCount);
+	std::printf("bytes per registered event type        %8.1f\n", type);
+
+	return bench::finish();
+}
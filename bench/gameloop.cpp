@@ -0,0 +1,254 @@
+/*
+
+Game-loop workload modeled on the README App: actors subscribe to E_PreTick, E_Tick and E_Update,
+schedule event and urgent actions, publish nested events, and are spawned and despawned every frame.
+Reports the frame time distribution and the allocations made once the loop is warm.
+
+Usage: bench_gameloop [actors = 10000] [frames = 300] [respawns per frame = 16] [harness options]
+Every measured frame is a sample of the "frame" result in the JSON report.
+
+*/
+
+#include <EventManager/EventManager.hpp>
+#include <EventManager/Histogram.hpp>
+
+#include "Bench.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+struct App
+{
+	struct E_PreTick : el::EventBase { };
+	struct E_Tick    : el::EventBase { };
+
+	struct E_Update : el::EventBase
+	{
+		float dt = 1.f / 60.f;
+	};
+};
+
+struct E_Hit : el::EventBase
+{
+	uint32_t damage{};
+};
+
+bench::Random g_random;
+
+class MyReceiver : public el::EventReceiver
+{
+public:
+	virtual ~MyReceiver() = default;
+
+	float time{};
+
+protected:
+	MyReceiver()
+	{
+		EM.subscribe(*this, &MyReceiver::onUpdate);
+	}
+
+	virtual void onUpdate(App::E_Update const& e)
+	{
+		time += e.dt;
+	}
+};
+
+class Actor : public MyReceiver
+{
+public:
+	uint64_t work{};
+
+	Actor()
+	{
+		EM.subscribe(*this, &Actor::onTick);
+
+		EM.subscribe<App::E_PreTick>(*this,
+			[this](App::E_PreTick const&)
+			{
+				work++;
+			}
+		);
+	}
+
+private:
+	void onTick(App::E_Tick const&)
+	{
+		auto roll = g_random.next();
+
+		if ((roll & 15) == 0)
+		{
+			EM.schedule<App::E_Update>(
+				[this]
+				{
+					work += 2;
+				}
+			);
+		}
+
+		if ((roll & 63) == 1)
+		{
+			EM.schedule(
+				[this]
+				{
+					work += 3;
+				}
+			);
+		}
+
+		if ((roll & 255) == 2)
+		{
+			E_Hit hit;
+			hit.damage = static_cast<uint32_t>(roll >> 56);
+
+			EM.publish(std::move(hit));
+		}
+	}
+};
+
+class Scoreboard : public el::EventReceiver
+{
+public:
+	uint64_t damage{};
+
+	Scoreboard()
+	{
+		EM.subscribe(*this, &Scoreboard::onHit);
+	}
+
+private:
+	void onHit(E_Hit const& e)
+	{
+		damage += e.damage;
+
+		if (e.damage > 250)
+			e.handled = true;
+	}
+};
+
+// Owns the actors and replaces a few random ones every frame
+class World : public el::EventReceiver
+{
+public:
+	World(size_t actors, size_t respawns) :
+		m_respawns(respawns)
+	{
+		m_actors.reserve(actors);
+
+		for (size_t i = 0; i < actors; i++)
+			m_actors.push_back(std::make_unique<Actor>());
+
+		EM.subscribe(*this, &World::onUpdate);
+	}
+
+	inline uint64_t work() const
+	{
+		uint64_t sum = 0;
+
+		for (auto& actor : m_actors)
+			sum += actor->work;
+
+		return sum;
+	}
+
+private:
+	std::vector<std::unique_ptr<Actor> >	m_actors;
+	size_t									m_respawns;
+
+	void onUpdate(App::E_Update const&)
+	{
+		if (m_actors.empty())
+			return;
+
+		// Despawn outside of the dispatch, actions scheduled by the actors have run by then
+		EM.schedule(
+			[this]
+			{
+				for (size_t i = 0; i < m_respawns; i++)
+					m_actors[g_random.next() % m_actors.size()] = std::make_unique<Actor>();
+			}
+		);
+	}
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	EVENT_MANAGER_GET();
+
+	bench::init(argc, argv);
+
+	size_t actors	= argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 10'000;
+	size_t frames	= argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 300;
+	size_t respawns	= argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 16;
+
+	size_t warmup = std::max<size_t>(frames / 10, 1);
+
+	std::printf("%zu actors, %zu frames (%zu warm-up), %zu respawns per frame\n", actors, frames, warmup, respawns);
+
+	Scoreboard	scoreboard;
+	World		world(actors, respawns);
+
+	el::Histogram		frameTimes;
+	bench::Allocations	allocated;
+
+	bench::Result result{ "frame, " + std::to_string(actors) + " actors", frames, 0, 0, {} };
+	result.samples.reserve(frames);
+
+	for (size_t frame = 0; frame < warmup + frames; frame++)
+	{
+		if (frame == warmup)
+			allocated = bench::allocations();
+
+		auto begin = std::chrono::steady_clock::now();
+
+		EM.publish(App::E_PreTick());
+		EM.publish(App::E_Tick());
+		EM.publish(App::E_Update());
+
+		auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+
+		if (frame >= warmup)
+		{
+			frameTimes.record(static_cast<uint64_t>(elapsed.count()));
+			result.samples.push_back(static_cast<double>(elapsed.count()));
+		}
+	}
+
+	auto steady = bench::allocations() - allocated;
+
+	auto ms = [](uint64_t ns)
+	{
+		return static_cast<double>(ns) / 1e6;
+	};
+
+	std::printf("frame time, ms: mean %.3f, p50 %.3f, p90 %.3f, p99 %.3f, p99.9 %.3f, max %.3f\n",
+		frameTimes.mean() / 1e6,
+		ms(frameTimes.percentile(0.5)),
+		ms(frameTimes.percentile(0.9)),
+		ms(frameTimes.percentile(0.99)),
+		ms(frameTimes.percentile(0.999)),
+		ms(frameTimes.max()));
+
+	std::printf("steady state: %.1f allocs/frame, %.1f bytes/frame\n",
+		static_cast<double>(steady.count) / static_cast<double>(frames),
+		static_cast<double>(steady.bytes) / static_cast<double>(frames));
+
+	result.nsPerOp		= frameTimes.mean();
+	result.allocsPerOp	= static_cast<double>(steady.count) / static_cast<double>(frames);
+
+	bench::report(std::move(result));
+
+	bench::doNotOptimize(world.work());
+	bench::doNotOptimize(scoreboard.damage);
+
+	return bench::finish();
+}
@@ -0,0 +1,136 @@
+/*
+
+Publish latency distribution: every publish is timed and recorded into a histogram.
+In the cold mode a buffer larger than the last-level cache is streamed through before each publish,
+so the handler table, its list nodes, the hash buckets and the receivers have to come from memory.
+
+Usage: bench_latency [warm samples = 100000] [cold samples = 1000] [cold buffer MiB = 64]
+
+*/
+
+#include <EventManager/EventManager.hpp>
+#include <EventManager/Histogram.hpp>
+
+#include "Bench.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+struct E_Latency : el::EventBase
+{
+	uint64_t value = 1;
+};
+
+class Receiver : public el::EventReceiver
+{
+public:
+	uint64_t sum{};
+
+	Receiver()
+	{
+		EM.subscribe(*this, &Receiver::onLatency);
+	}
+
+private:
+	void onLatency(E_Latency const& e)
+	{
+		sum += e.value;
+	}
+};
+
+// Evicts the caches by touching every line of a buffer larger than them
+class Evictor
+{
+public:
+	explicit Evictor(size_t bytes) :
+		m_buffer(bytes, 1) { }
+
+	inline void run()
+	{
+		for (size_t i = 0; i < m_buffer.size(); i += 64)
+			m_buffer[i]++;
+
+		bench::doNotOptimize(m_buffer[0]);
+	}
+
+private:
+	std::vector<unsigned char> m_buffer;
+};
+
+void measure(std::string const& name, size_t samples, Evictor* evictor)
+{
+	EVENT_MANAGER_GET();
+
+	using Clock = std::chrono::steady_clock;
+
+	el::Histogram histogram;
+
+	bench::Result result{ name, samples, 0, 0, {} };
+	result.samples.reserve(samples);
+
+	// Warm up the allocations of the first publish
+	EM.publish(E_Latency());
+
+	for (size_t i = 0; i < samples; i++)
+	{
+		if (evictor)
+			evictor->run();
+
+		auto begin = Clock::now();
+
+		EM.publish(E_Latency());
+
+		auto ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+
+		histogram.record(ns);
+		result.samples.push_back(static_cast<double>(ns));
+	}
+
+	std::printf("%-40s %10llu %10llu %10llu %10llu %12llu\n", name.c_str(),
+		static_cast<unsigned long long>(histogram.percentile(0.5)),
+		static_cast<unsigned long long>(histogram.percentile(0.99)),
+		static_cast<unsigned long long>(histogram.percentile(0.999)),
+		static_cast<unsigned long long>(histogram.max()),
+		static_cast<unsigned long long>(histogram.count()));
+
+	result.nsPerOp = static_cast<double>(histogram.percentile(0.5));
+
+	bench::report(std::move(result));
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench::init(argc, argv);
+
+	size_t warmSamples	= argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 100'000;
+	size_t coldSamples	= argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1'000;
+	size_t bufferMiB	= argc > 3 ? std::strtoull(argv[3], nullptr, 10) : 64;
+
+	Evictor evictor(bufferMiB << 20);
+
+	std::printf("%-40s %10s %10s %10s %10s %12s\n", "publish latency, ns", "p50", "p99", "p99.9", "max", "samples");
+
+	for (size_t subscribers : { 1, 10, 100, 1'000 })
+	{
+		// Allocated one by one, like receivers spawned over time
+		std::vector<std::unique_ptr<Receiver> > receivers;
+
+		for (size_t i = 0; i < subscribers; i++)
+			receivers.push_back(std::make_unique<Receiver>());
+
+		auto name = std::to_string(subscribers) + " subscribers";
+
+		measure(name + ", warm", warmSamples, nullptr);
+		measure(name + ", cold", coldSamples, &evictor);
+	}
+
+	return bench::finish();
+}
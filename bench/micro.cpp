@@ -0,0 +1,464 @@
+/*
+
+Microbenchmarks of the public API: publish against the number and kind of subscribers,
+the handled early exit, wildcard subscribers, ordering constraints, subscription churn, unsubscribeAll, scheduled actions and nested publishes.
+
+*/
+
+#include <EventManager/EventManager.hpp>
+
+#include "Bench.hpp"
+
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+struct E_Bench : el::EventBase
+{
+	int value = 1;
+};
+
+// Distinct event types for unsubscribeAll
+template <size_t N>
+struct E_Many : el::EventBase { };
+
+constexpr size_t ManyTypes = 256;
+
+// Each level publishes the next one from its handler
+template <size_t Depth>
+struct E_Nested : el::EventBase { };
+
+constexpr size_t NestedDepth = 8;
+
+class MethodReceiver : public el::EventReceiver
+{
+public:
+	uint64_t sum{};
+
+	MethodReceiver()
+	{
+		subscribe();
+	}
+
+	void subscribe()
+	{
+		EM.subscribe(*this, &MethodReceiver::onBench);
+	}
+
+private:
+	void onBench(E_Bench const& e)
+	{
+		sum += e.value;
+	}
+};
+
+class LambdaReceiver : public el::EventReceiver
+{
+public:
+	uint64_t sum{};
+
+	LambdaReceiver()
+	{
+		EM.subscribe<E_Bench>(*this,
+			[this](E_Bench const& e)
+			{
+				sum += e.value;
+			}
+		);
+	}
+};
+
+class StopReceiver : public el::EventReceiver
+{
+public:
+	StopReceiver()
+	{
+		EM.subscribe(*this, &StopReceiver::onBench);
+	}
+
+private:
+	void onBench(E_Bench const& e)
+	{
+		e.handled = true;
+	}
+};
+
+// Sees every event type
+class AnyReceiver : public el::EventReceiver
+{
+public:
+	uint64_t count{};
+
+	AnyReceiver()
+	{
+		EM.subscribeAny(*this,
+			[this](std::type_info const&, el::EventBase const&)
+			{
+				count++;
+			}
+		);
+	}
+};
+
+// Runs before every MethodReceiver through a constraint
+class FirstReceiver : public el::EventReceiver
+{
+public:
+	uint64_t sum{};
+
+	FirstReceiver()
+	{
+		EM.subscribe(*this, &FirstReceiver::onBench, el::before<MethodReceiver>());
+	}
+
+private:
+	void onBench(E_Bench const& e)
+	{
+		sum += e.value;
+	}
+};
+
+// Answers queries with the event value
+class QueryReceiver : public el::EventReceiver
+{
+public:
+	QueryReceiver()
+	{
+		EM.subscribe(*this, &QueryReceiver::onBench);
+	}
+
+private:
+	uint64_t onBench(E_Bench const& e)
+	{
+		return e.value;
+	}
+};
+
+class ManyReceiver : public el::EventReceiver
+{
+public:
+	template <size_t... I>
+	void subscribeAll(std::index_sequence<I...>)
+	{
+		(EM.subscribe<E_Many<I> >(*this, [](E_Many<I> const&) { }), ...);
+	}
+};
+
+class NestedReceiver : public el::EventReceiver
+{
+public:
+	uint64_t calls{};
+
+	NestedReceiver()
+	{
+		subscribe(std::make_index_sequence<NestedDepth>());
+	}
+
+private:
+	template <size_t... I>
+	void subscribe(std::index_sequence<I...>)
+	{
+		(EM.subscribe<E_Nested<I> >(*this,
+			[this](E_Nested<I> const&)
+			{
+				calls++;
+
+				if constexpr (I + 1 < NestedDepth)
+					EM.publish(E_Nested<I + 1>());
+			}
+		), ...);
+	}
+};
+
+// Keep the number of handler calls per repetition roughly constant
+constexpr uint64_t iterationsFor(size_t subscribers)
+{
+	return std::max<uint64_t>(10'000'000 / (subscribers + 1), 100);
+}
+
+template <typename Receiver>
+void publishTo(size_t subscribers, std::string const& kind)
+{
+	EVENT_MANAGER_GET();
+
+	std::vector<Receiver> receivers(subscribers);
+
+	bench::run("publish, " + std::to_string(subscribers) + " " + kind + " subscribers", iterationsFor(subscribers),
+		[&](uint64_t n)
+		{
+			for (uint64_t i = 0; i < n; i++)
+				EM.publish(E_Bench());
+		}
+	);
+
+	if (!receivers.empty())
+		bench::doNotOptimize(receivers.front().sum);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	EVENT_MANAGER_GET();
+
+	bench::init(argc, argv);
+
+	// Publish
+	for (size_t subscribers : { 0, 1, 10, 1'000, 100'000 })
+		publishTo<MethodReceiver>(subscribers, "method");
+
+	publishTo<LambdaReceiver>(10, "lambda");
+	publishTo<LambdaReceiver>(1'000, "lambda");
+
+	{
+		StopReceiver				stop;
+		std::vector<MethodReceiver>	receivers(999);
+
+		bench::run("publish, handled by the first of 1000", iterationsFor(1),
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+					EM.publish(E_Bench());
+			}
+		);
+	}
+
+	{
+		MethodReceiver	receiver;
+		AnyReceiver		any;
+
+		bench::run("publish, 1 method and 1 wildcard subscriber", iterationsFor(2),
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+					EM.publish(E_Bench());
+			}
+		);
+
+		bench::doNotOptimize(any.count);
+	}
+
+	{
+		std::vector<MethodReceiver> receivers(1'000);
+
+		// Half of them in group 1, subscribed again
+		for (size_t i = 0; i < receivers.size(); i += 2)
+		{
+			EM.unsubscribe<E_Bench>(receivers[i]);
+			EM.subscribe<E_Bench>(receivers[i], [](E_Bench const&) { }, el::Group{ 1 });
+		}
+
+		EM.pauseGroup(el::Group{ 1 });
+
+		bench::run("publish, 1000 with 500 in a paused group", iterationsFor(1'000),
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+					EM.publish(E_Bench());
+			}
+		);
+
+		bench::run("pause + resume a group of 500", iterationsFor(0),
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+				{
+					EM.resumeGroup(el::Group{ 1 });
+					EM.pauseGroup(el::Group{ 1 });
+				}
+			}
+		);
+
+		EM.resumeGroup(el::Group{ 1 });
+	}
+
+	{
+		std::vector<MethodReceiver>	subscribers(1'000);
+		std::vector<ManyReceiver>	receivers(1'000);
+
+		// A Connection removes its entry through a slot, without looking the receiver up
+		bench::run("connect + disconnect, 1000 subscribers", 100'000,
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+				{
+					auto connection = EM.connect<E_Bench>(receivers[i % receivers.size()], [](E_Bench const&) { });
+				}
+			}
+		);
+
+		bench::run("subscribe + unsubscribe, 1000 subscribers", 100'000,
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+				{
+					EM.subscribe<E_Bench>(receivers[i % receivers.size()], [](E_Bench const&) { });
+					EM.unsubscribe<E_Bench>(receivers[i % receivers.size()]);
+				}
+			}
+		);
+	}
+
+	{
+		std::vector<QueryReceiver> receivers(1'000);
+
+		el::Sum<uint64_t> sum;
+
+		bench::run("query, 1000 subscribers into el::Sum", iterationsFor(1'000),
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+					EM.query<E_Bench, uint64_t>(E_Bench(), sum);
+			}
+		);
+
+		bench::doNotOptimize(sum.value);
+	}
+
+	{
+		std::vector<MethodReceiver>	receivers(999);
+		FirstReceiver				first;
+
+		bench::run("publish, 1000 with a before<> constraint", iterationsFor(1'000),
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+					EM.publish(E_Bench());
+			}
+		);
+
+		// Every subscription change sorts the table again on the next publish
+		bench::run("resubscribe + publish, 1000 with a constraint", 10'000,
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+				{
+					EM.unsubscribe<E_Bench>(receivers.back());
+					EM.subscribe<E_Bench>(receivers.back(), [](E_Bench const&) { });
+					EM.publish(E_Bench());
+				}
+			}
+		);
+
+		bench::doNotOptimize(first.sum);
+	}
+
+	// Subscriptions
+	{
+		MethodReceiver receiver;
+
+		bench::run("unsubscribe + subscribe, method", 1'000'000,
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+				{
+					EM.unsubscribe<E_Bench>(receiver);
+					receiver.subscribe();
+				}
+			}
+		);
+	}
+
+	{
+		std::vector<MethodReceiver> receivers(1'000);
+
+		MethodReceiver receiver;
+
+		bench::run("unsubscribe + subscribe, 1000 other subscribers", 100'000,
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+				{
+					EM.unsubscribe<E_Bench>(receiver);
+					EM.subscribe<E_Bench>(receiver, [](E_Bench const&) { });
+				}
+			}
+		);
+	}
+
+	{
+		// Another receiver keeps all the event types registered
+		ManyReceiver registered;
+		registered.subscribeAll(std::make_index_sequence<ManyTypes>());
+
+		bench::run("receiver lifetime, 1 of " + std::to_string(ManyTypes) + " event types", 200'000,
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+				{
+					ManyReceiver receiver;
+					receiver.subscribeAll(std::make_index_sequence<1>());
+				}
+			}
+		);
+
+		bench::run("receiver lifetime, " + std::to_string(ManyTypes) + " of " + std::to_string(ManyTypes) + " event types", 2'000,
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+				{
+					ManyReceiver receiver;
+					receiver.subscribeAll(std::make_index_sequence<ManyTypes>());
+				}
+			}
+		);
+	}
+
+	// Actions
+	bench::run("schedule urgent action + publish", 2'000'000,
+		[&](uint64_t n)
+		{
+			for (uint64_t i = 0; i < n; i++)
+			{
+				EM.schedule([] { });
+				EM.publish(E_Bench());
+			}
+		}
+	);
+
+	bench::run("schedule event action + publish", 2'000'000,
+		[&](uint64_t n)
+		{
+			for (uint64_t i = 0; i < n; i++)
+			{
+				EM.schedule<E_Bench>([] { });
+				EM.publish(E_Bench());
+			}
+		}
+	);
+
+	bench::run("schedule 16 event actions + publish", 200'000,
+		[&](uint64_t n)
+		{
+			for (uint64_t i = 0; i < n; i++)
+			{
+				for (int j = 0; j < 16; j++)
+					EM.schedule<E_Bench>([] { });
+
+				EM.publish(E_Bench());
+			}
+		}
+	);
+
+	// Nested publishes
+	{
+		NestedReceiver receiver;
+
+		bench::run("nested publishes, depth " + std::to_string(NestedDepth), 1'000'000,
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+					EM.publish(E_Nested<0>());
+			}
+		);
+
+		bench::doNotOptimize(receiver.calls);
+	}
+
+	return bench::finish();
+}
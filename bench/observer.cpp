@@ -0,0 +1,158 @@
+/*
+
+Cost of the observer hooks.
+
+bench_observer uses the default el::NullObserver, bench_observer_noinline an observer whose
+hooks are empty but cannot be inlined, bench_observer_counting one that counts every hook.
+The default build should match the no-hook cost, i.e. be measurably faster than the
+non-inlined build, which pays only for the calls themselves.
+
+*/
+
+#include <cstdint>
+#include <typeindex>
+#include <typeinfo>
+
+namespace el { enum class CallKind : uint8_t; }
+
+#if defined(BENCH_OBSERVER_COUNTING)
+
+struct BenchObserver
+{
+	uint64_t calls{};
+
+	void onPublishBegin(std::type_index)									{ calls++; }
+	void onPublishEnd(std::type_index)										{ calls++; }
+	void onHandlerBegin(std::type_index, void*, std::type_info const&)	{ calls++; }
+	void onHandlerEnd(std::type_index, void*, std::type_info const&)		{ calls++; }
+	void onSubscribe(std::type_index, void*)								{ calls++; }
+	void onUnsubscribe(std::type_index, void*)								{ calls++; }
+	void onSchedule(el::CallKind, std::type_index)							{ calls++; }
+	void onActionBegin(el::CallKind, std::type_index)						{ calls++; }
+	void onActionEnd(el::CallKind, std::type_index)							{ calls++; }
+};
+
+#define EVENT_MANAGER_OBSERVER BenchObserver
+
+#elif defined(BENCH_OBSERVER_NOINLINE)
+
+// An empty asm statement keeps GCC from proving the hooks side-effect free and dropping the calls
+#if defined(_MSC_VER)
+	#define BENCH_NOINLINE	__declspec(noinline)
+	#define BENCH_OPAQUE
+#else
+	#define BENCH_NOINLINE	__attribute__((noinline))
+	#define BENCH_OPAQUE	asm volatile("")
+#endif
+
+struct BenchObserver
+{
+	BENCH_NOINLINE void onPublishBegin(std::type_index)									{ BENCH_OPAQUE; }
+	BENCH_NOINLINE void onPublishEnd(std::type_index)										{ BENCH_OPAQUE; }
+	BENCH_NOINLINE void onHandlerBegin(std::type_index, void*, std::type_info const&)	{ BENCH_OPAQUE; }
+	BENCH_NOINLINE void onHandlerEnd(std::type_index, void*, std::type_info const&)		{ BENCH_OPAQUE; }
+	BENCH_NOINLINE void onSubscribe(std::type_index, void*)								{ BENCH_OPAQUE; }
+	BENCH_NOINLINE void onUnsubscribe(std::type_index, void*)								{ BENCH_OPAQUE; }
+	BENCH_NOINLINE void onSchedule(el::CallKind, std::type_index)							{ BENCH_OPAQUE; }
+	BENCH_NOINLINE void onActionBegin(el::CallKind, std::type_index)						{ BENCH_OPAQUE; }
+	BENCH_NOINLINE void onActionEnd(el::CallKind, std::type_index)							{ BENCH_OPAQUE; }
+};
+
+#define EVENT_MANAGER_OBSERVER BenchObserver
+
+#endif
+
+#include <EventManager/EventManager.hpp>
+
+#include "Bench.hpp"
+
+#include <type_traits>
+#include <vector>
+
+static_assert(std::is_empty_v<el::NullObserver>);
+
+namespace
+{
+
+struct E_Bench : el::EventBase
+{
+	int value = 1;
+};
+
+class Receiver : public el::EventReceiver
+{
+public:
+	uint64_t sum{};
+
+	Receiver()
+	{
+		EM.subscribe(*this, &Receiver::onBench);
+	}
+
+private:
+	void onBench(E_Bench const& e)
+	{
+		sum += e.value;
+	}
+};
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	EVENT_MANAGER_GET();
+
+	bench::init(argc, argv);
+
+#if defined(BENCH_OBSERVER_COUNTING)
+	std::printf("observer: counting\n");
+#elif defined(BENCH_OBSERVER_NOINLINE)
+	std::printf("observer: non-inlined empty hooks\n");
+#else
+	std::printf("observer: el::NullObserver\n");
+#endif
+
+	{
+		std::vector<Receiver> receivers(10);
+
+		bench::run("publish, 10 subscribers", 2'000'000,
+			[&](uint64_t n)
+			{
+				for (uint64_t i = 0; i < n; i++)
+					EM.publish(E_Bench());
+			}
+		);
+
+		bench::doNotOptimize(receivers.front().sum);
+	}
+
+	bench::run("subscribe + unsubscribe", 2'000'000,
+		[&](uint64_t n)
+		{
+			Receiver receiver;
+
+			for (uint64_t i = 0; i < n; i++)
+			{
+				EM.unsubscribe<E_Bench>(receiver);
+				EM.subscribe<E_Bench>(receiver, [](E_Bench const&) { });
+			}
+		}
+	);
+
+	bench::run("schedule event action + publish", 2'000'000,
+		[&](uint64_t n)
+		{
+			for (uint64_t i = 0; i < n; i++)
+			{
+				EM.schedule<E_Bench>([] { });
+				EM.publish(E_Bench());
+			}
+		}
+	);
+
+#if defined(BENCH_OBSERVER_COUNTING)
+	std::printf("hook calls: %llu\n", static_cast<unsigned long long>(EM.observer().calls));
+#endif
+
+	return bench::finish();
+}
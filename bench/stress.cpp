@@ -0,0 +1,849 @@
+/*
+
+Differential stress test of reentrant dispatch. A random operation stream drives the real bus and
+a simple reference model; handlers create, destroy, subscribe and unsubscribe receivers (themselves
+included), stop the dispatch and publish nested events of the same or other types. Both must deliver
+the same sequence. Each round is reproducible from its seed.
+
+Usage: bench_stress [seconds = 5] [seed = 1]
+
+Semantics checked:
+- receivers are notified by phase, then by descending priority, then in subscription order;
+  subscribing again to the same phase is ignored, unsubscribing removes every phase
+- a receiver unsubscribed (or destroyed) during a dispatch is not notified afterwards
+- a receiver subscribed during a dispatch only gets the publishes that start after it subscribed
+- EventBase::handled stops the dispatch of that event only
+- wildcard subscribers get every event after the subscribers of its type, handled or not,
+  including wildcard subscribers added by those
+- subscriptions of a paused group are skipped, from the next receiver on when paused by a handler
+- a Connection removes only its own subscription, and nothing once that is gone
+- el::before(receiver) / el::after(receiver) move a subscription ahead of or behind the subscriptions
+  of that receiver in the same phase, contradicting ones are dropped; constraints naming a receiver
+  are dropped when it unsubscribes from everything
+- receivers have EventReceiver as their second base, at another address than the receiver itself
+- checked once up front: el::before<R>() / el::after<R>() and the reporting of order cycles
+
+*/
+
+#include <EventManager/EventManager.hpp>
+
+#include "Bench.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+constexpr uint32_t Types			= 4;
+constexpr uint32_t Receivers		= 24;
+constexpr uint32_t MaxDepth			= 3;	// nesting of reentrant operations
+constexpr uint32_t OpsPerRound		= 20'000;
+constexpr uint32_t Priorities		= 3;
+constexpr uint32_t Phases			= 3;
+constexpr uint32_t Any				= Types;	// wildcard subscriptions
+constexpr uint32_t Groups			= 2;
+constexpr uint32_t NoTarget			= Receivers;
+constexpr uint16_t PublishBegin		= 0xFFFF;
+constexpr uint16_t PublishEnd		= 0xFFFE;
+
+template <uint32_t I>
+struct E_Stress : el::EventBase { };
+
+// Calls fn.operator()<I>() for the runtime type index
+template <typename Fn>
+inline void withType(uint32_t type, Fn&& fn)
+{
+	[&]<uint32_t... I>(std::integer_sequence<uint32_t, I...>)
+	{
+		((type == I ? (fn.template operator()<I>(), 0) : 0), ...);
+	}(std::make_integer_sequence<uint32_t, Types>());
+}
+
+// Index of an E_Stress type
+inline uint32_t typeIndex(std::type_info const& type)
+{
+	return [&]<uint32_t... I>(std::integer_sequence<uint32_t, I...>)
+	{
+		uint32_t index = 0;
+		((type == typeid(E_Stress<I>) ? (index = I, 0) : 0), ...);
+
+		return index;
+	}(std::make_integer_sequence<uint32_t, Types>());
+}
+
+struct Options
+{
+	uint32_t	phase;
+	int32_t		priority;
+	uint32_t	group;
+	uint32_t	target;		// of an el::before / el::after constraint, or NoTarget
+	bool		after;
+};
+
+struct Entry
+{
+	uint16_t receiver;	// or PublishBegin / PublishEnd
+	uint16_t type;
+
+	bool operator == (Entry const&) const = default;
+};
+
+using Log = std::vector<Entry>;
+
+// Receives the deliveries of a bus
+class Sink
+{
+public:
+	virtual ~Sink() = default;
+
+	virtual void deliver(uint32_t receiver, uint32_t type, bool& handled) = 0;
+};
+
+// A base ahead of EventReceiver, so that the receiver's address differs from its EventReceiver's
+class Component
+{
+public:
+	virtual ~Component() = default;
+
+	uint64_t component{};
+};
+
+class StressReceiver : public Component, public el::EventReceiver
+{
+public:
+	StressReceiver(Sink& sink, uint32_t id) :
+		m_sink(sink), m_id(id) { }
+
+	template <uint32_t I>
+	void on(E_Stress<I> const& e)
+	{
+		// May destroy this receiver, nothing is touched afterwards
+		m_sink.deliver(m_id, I, e.handled);
+	}
+
+private:
+	Sink&		m_sink;
+	uint32_t	m_id;
+};
+
+class RealBus
+{
+public:
+	explicit RealBus(Sink& sink) :
+		m_sink(sink) { }
+
+	~RealBus()
+	{
+		for (auto& receiver : m_receivers)
+			receiver.reset();
+
+		EM.setActiveGroups(~uint64_t(0));
+	}
+
+	void create(uint32_t r)
+	{
+		m_receivers[r] = std::make_unique<StressReceiver>(m_sink, r);
+	}
+
+	void destroy(uint32_t r)
+	{
+		m_receivers[r].reset();
+	}
+
+	void subscribe(uint32_t r, uint32_t type, bool method, Options const& options)
+	{
+		auto& receiver = *m_receivers[r];
+
+		withOptions(options,
+			[&](auto... settings)
+			{
+				if (type == Any)
+				{
+					EM.subscribeAny(receiver,
+						[&sink = m_sink, r](std::type_info const& type, el::EventBase const& e)
+						{
+							sink.deliver(r, typeIndex(type), e.handled);
+						},
+						settings...
+					);
+
+					return;
+				}
+
+				withType(type,
+					[&]<uint32_t I>()
+					{
+						if (method)
+							EM.subscribe(receiver, &StressReceiver::on<I>, settings...);
+						else
+						{
+							EM.subscribe<E_Stress<I> >(receiver,
+								[&sink = m_sink, r](E_Stress<I> const& e)
+								{
+									sink.deliver(r, I, e.handled);
+								},
+								settings...
+							);
+						}
+					}
+				);
+			}
+		);
+	}
+
+	// Kept only if it subscribed
+	void connect(uint32_t r, uint32_t type, Options const& options)
+	{
+		withOptions(options,
+			[&](auto... settings)
+			{
+				withType(type,
+					[&]<uint32_t I>()
+					{
+						auto connection = EM.connect(*m_receivers[r], &StressReceiver::on<I>, settings...);
+
+						if (connection.connected())
+							m_connections.push_back(std::move(connection));
+					}
+				);
+			}
+		);
+	}
+
+	size_t connections() const
+	{
+		return m_connections.size();
+	}
+
+	void disconnect(size_t index)
+	{
+		// Moved out first, disconnecting may publish and connect again
+		auto connection = std::move(m_connections[index]);
+
+		m_connections[index] = std::move(m_connections.back());
+		m_connections.pop_back();
+
+		connection.disconnect();
+	}
+
+	void unsubscribe(uint32_t r, uint32_t type)
+	{
+		auto& receiver = *m_receivers[r];
+
+		if (type == Any)
+			return EM.unsubscribeAny(receiver);
+
+		withType(type,
+			[&]<uint32_t I>()
+			{
+				EM.unsubscribe<E_Stress<I> >(receiver);
+			}
+		);
+	}
+
+	void unsubscribeAll(uint32_t r)
+	{
+		EM.unsubscribeAll(*m_receivers[r]);
+	}
+
+	void toggle(uint32_t group)
+	{
+		el::Group const which{ static_cast<uint8_t>(group) };
+
+		if (EM.isGroupActive(which))
+			EM.pauseGroup(which);
+		else
+			EM.resumeGroup(which);
+	}
+
+	void publish(uint32_t type)
+	{
+		withType(type,
+			[&]<uint32_t I>()
+			{
+				EM.publish(E_Stress<I>());
+			}
+		);
+	}
+
+private:
+	el::EventManager&	EM = el::EventManager::get();
+	Sink&				m_sink;
+
+	std::array<std::unique_ptr<StressReceiver>, Receivers> m_receivers;
+
+	std::vector<el::Connection> m_connections;
+
+	// Calls fn with the el:: options
+	template <typename Fn>
+	void withOptions(Options const& options, Fn&& fn)
+	{
+		auto const phase	= static_cast<el::Phase>(options.phase);
+		auto const priority	= el::Priority{ options.priority };
+		auto const group	= el::Group{ static_cast<uint8_t>(options.group) };
+
+		if (options.target == NoTarget)
+			return fn(phase, priority, group);
+
+		auto& target = *m_receivers[options.target];
+
+		fn(phase, priority, group, options.after ? el::after(target) : el::before(target));
+	}
+};
+
+// Reference: one vector per type sorted by phase and priority, plus one for wildcards; a publish walks
+// copies of them, reordered by the constraints
+class ModelBus
+{
+public:
+	explicit ModelBus(Sink& sink) :
+		m_sink(sink) { }
+
+	void create(uint32_t) { }
+
+	void destroy(uint32_t r)
+	{
+		unsubscribeAll(r);
+	}
+
+	// Returns the subscription id, 0 if already subscribed in this phase
+	uint64_t subscribe(uint32_t r, uint32_t type, bool, Options const& options)
+	{
+		auto phase = options.phase;
+
+		if (m_active[r][type][phase])
+			return 0;
+
+		m_active[r][type][phase] = ++m_serial;
+
+		// After every subscription of an earlier phase or the same phase and a higher or equal priority
+		auto& order = m_order[type];
+
+		auto it = order.begin();
+		while (it != order.end() && (it->phase < phase || (it->phase == phase && it->priority >= options.priority)))
+			++it;
+
+		order.insert(it, { r, m_serial, phase, options.priority, options.group, options.target, options.after });
+
+		return m_serial;
+	}
+
+	void connect(uint32_t r, uint32_t type, Options const& options)
+	{
+		if (auto id = subscribe(r, type, true, options))
+			m_connections.push_back({ r, type, options.phase, id });
+	}
+
+	size_t connections() const
+	{
+		return m_connections.size();
+	}
+
+	void disconnect(size_t index)
+	{
+		auto connection = m_connections[index];
+
+		m_connections[index] = m_connections.back();
+		m_connections.pop_back();
+
+		auto& active = m_active[connection.receiver][connection.type][connection.phase];
+
+		if (active == connection.id)
+			remove(connection.type, std::exchange(active, 0));
+	}
+
+	void unsubscribe(uint32_t r, uint32_t type)
+	{
+		for (auto& active : m_active[r][type])
+			if (auto id = std::exchange(active, 0))
+				remove(type, id);
+	}
+
+	void unsubscribeAll(uint32_t r)
+	{
+		for (uint32_t type = 0; type <= Any; type++)
+		{
+			unsubscribe(r, type);
+
+			for (auto& subscription : m_order[type])
+				if (subscription.target == r)
+					subscription.target = NoTarget;
+		}
+	}
+
+	void toggle(uint32_t group)
+	{
+		m_paused[group] = !m_paused[group];
+	}
+
+	void publish(uint32_t type)
+	{
+		auto snapshot = sorted(m_order[type]);
+		notify(snapshot, type, type);
+
+		// Wildcards subscribed by the subscribers of the type are notified too
+		auto wildcards = sorted(m_order[Any]);
+		notify(wildcards, Any, type);
+	}
+
+private:
+	struct Subscription
+	{
+		uint32_t receiver;
+		uint64_t id;
+		uint32_t phase;
+		int32_t  priority;
+		uint32_t group;
+		uint32_t target;
+		bool     after;
+	};
+
+	struct Connection
+	{
+		uint32_t receiver;
+		uint32_t type;
+		uint32_t phase;
+		uint64_t id;
+	};
+
+	using Active = std::array<std::array<uint64_t, Phases>, Types + 1>;	// subscription ids, 0 when not subscribed
+
+	Sink&												m_sink;
+	std::array<std::vector<Subscription>, Types + 1>	m_order;
+	std::array<Active, Receivers>						m_active{};
+	std::array<bool, Groups>							m_paused{};
+	std::vector<Connection>								m_connections;
+	uint64_t											m_serial{};
+
+	void remove(uint32_t type, uint64_t id)
+	{
+		auto& order = m_order[type];
+
+		for (auto it = order.begin(); it != order.end(); ++it)
+		{
+			if (it->id == id)
+			{
+				order.erase(it);
+				break;
+			}
+		}
+	}
+
+	// The bus's order, spelled out: every subscription in list order, each after its predecessors.
+	// The front gate of (phase, receiver) precedes that receiver's subscriptions and follows those
+	// constrained before it, the back gate the other way round. An edge back into the current path
+	// closes a cycle and is dropped.
+	static std::vector<Subscription> sorted(std::vector<Subscription> const& order)
+	{
+		auto count = static_cast<uint32_t>(order.size());
+
+		std::vector<std::vector<uint32_t> >	predecessors(count);
+		std::map<std::pair<uint32_t, uint32_t>, std::pair<uint32_t, uint32_t> > gates;	// (front, back), 0 when none
+
+		auto gate = [&](uint32_t& node)
+		{
+			if (!node)
+			{
+				node = static_cast<uint32_t>(predecessors.size());
+				predecessors.emplace_back();
+			}
+
+			return node;
+		};
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			auto& subscription = order[i];
+
+			if (subscription.target == NoTarget)
+				continue;
+
+			auto& [front, back] = gates[{ subscription.phase, subscription.target }];
+
+			if (subscription.after)
+			{
+				auto node = gate(back);	// may grow predecessors
+				predecessors[i].push_back(node);
+			}
+
+			else
+				predecessors[gate(front)].push_back(i);
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			auto it = gates.find({ order[i].phase, order[i].receiver });
+			if (it == gates.end())
+				continue;
+
+			auto [front, back] = it->second;
+
+			if (front)
+				predecessors[i].push_back(front);
+
+			if (back)
+				predecessors[back].push_back(i);
+		}
+
+		enum : uint8_t { New, Active, Emitted };
+
+		std::vector<uint8_t>		state(predecessors.size(), New);
+		std::vector<Subscription>	result;
+
+		auto visit = [&](auto& self, uint32_t node) -> void
+		{
+			state[node] = Active;
+
+			for (size_t k = 0; k < predecessors[node].size(); k++)
+				if (state[predecessors[node][k]] == New)
+					self(self, predecessors[node][k]);
+
+			state[node] = Emitted;
+
+			if (node < count)
+				result.push_back(order[node]);
+		};
+
+		for (uint32_t i = 0; i < count; i++)
+			if (state[i] == New)
+				visit(visit, i);
+
+		return result;
+	}
+
+	void notify(std::vector<Subscription> const& snapshot, uint32_t list, uint32_t type)
+	{
+		bool handled = false;
+
+		for (auto& subscription : snapshot)
+		{
+			if (m_active[subscription.receiver][list][subscription.phase] != subscription.id || m_paused[subscription.group])
+				continue;
+
+			m_sink.deliver(subscription.receiver, type, handled);
+
+			if (handled)
+				break;
+		}
+	}
+};
+
+// Generates the operation stream; deliveries draw from the same generator, so both buses
+// see identical streams for as long as their deliveries agree
+template <typename Bus>
+class Driver : public Sink
+{
+public:
+	uint64_t operations{};
+
+	explicit Driver(uint64_t seed) :
+		m_random(seed), m_bus(*this) { }
+
+	Log run()
+	{
+		for (uint32_t i = 0; i < OpsPerRound; i++)
+			step();
+
+		for (uint32_t r = 0; r < Receivers; r++)
+			if (m_alive[r])
+				destroy(r);
+
+		return std::move(m_log);
+	}
+
+	void deliver(uint32_t receiver, uint32_t type, bool& handled) final
+	{
+		operations++;
+		m_log.push_back({ static_cast<uint16_t>(receiver), static_cast<uint16_t>(type) });
+
+		if (m_depth >= MaxDepth)
+			return;
+
+		m_depth++;
+
+		for (uint32_t i = m_random.below(3); i; i--)
+			step();
+
+		m_depth--;
+
+		if (m_random.below(16) == 0)
+			handled = true;
+	}
+
+private:
+	bench::Random						m_random;
+	Bus									m_bus;
+	Log									m_log;
+	std::array<bool, Receivers>			m_alive{};
+	uint32_t							m_depth{};
+
+	void destroy(uint32_t r)
+	{
+		m_alive[r] = false;
+		m_bus.destroy(r);
+	}
+
+	void step()
+	{
+		operations++;
+
+		auto r		= m_random.below(Receivers);
+		auto type	= m_random.below(Types);
+		auto op		= m_random.below(16);
+
+		if (!m_alive[r])
+		{
+			m_alive[r] = true;
+			m_bus.create(r);
+
+			return;
+		}
+
+		if (op < 8 && m_random.below(8) == 0)
+			type = Any;
+
+		if (op < 5)
+		{
+			Options options{ m_random.below(Phases), static_cast<int32_t>(m_random.below(Priorities)) - 1, m_random.below(Groups), NoTarget, false };
+
+			if (m_random.below(4) == 0)
+			{
+				auto target = m_random.below(Receivers);
+
+				if (m_alive[target])
+				{
+					options.target	= target;
+					options.after	= m_random.below(2);
+				}
+			}
+
+			if (type != Any && m_random.below(4) == 0)
+				m_bus.connect(r, type, options);
+			else
+				m_bus.subscribe(r, type, op & 1, options);
+		}
+
+		else if (op < 8)
+			m_bus.unsubscribe(r, type);
+
+		else if (op < 9)
+			m_bus.unsubscribeAll(r);
+
+		else if (op < 10)
+			destroy(r);
+
+		else if (op < 11)
+			m_bus.toggle(m_random.below(Groups));
+
+		else if (op < 12 && m_bus.connections())
+			m_bus.disconnect(m_random.below(static_cast<uint32_t>(m_bus.connections())));
+
+		else
+		{
+			m_log.push_back({ PublishBegin, static_cast<uint16_t>(type) });
+			m_bus.publish(type);
+			m_log.push_back({ PublishEnd, static_cast<uint16_t>(type) });
+		}
+	}
+};
+
+struct E_Order : el::EventBase { };
+
+// Appends its name to the log when notified
+template <char Name>
+class Named : public el::EventReceiver
+{
+public:
+	explicit Named(std::string& log) :
+		m_log(log) { }
+
+	template <el::SubscribeOption... Options>
+	void subscribe(Options... options)
+	{
+		EM.subscribe(*this, &Named::on, options...);
+	}
+
+private:
+	std::string& m_log;
+
+	void on(E_Order const&)
+	{
+		m_log += Name;
+	}
+};
+
+using A = Named<'a'>;
+using B = Named<'b'>;
+using C = Named<'c'>;
+
+bool expect(char const* what, std::string const& actual, std::string const& expected)
+{
+	if (actual == expected)
+		return true;
+
+	std::printf("%s: expected %s, got %s\n", what, expected.c_str(), actual.c_str());
+	return false;
+}
+
+// Receiver-type constraints and cycle reporting, which the random stream doesn't reach
+bool checkOrdering()
+{
+	EVENT_MANAGER_GET();
+
+	std::string	log;
+	bool		ok = true;
+
+	auto order = [&]
+	{
+		log.clear();
+		EM.publish(E_Order());
+
+		return log;
+	};
+
+	{
+		A a(log); B b(log); C c(log);
+		a.subscribe(); b.subscribe(); c.subscribe(el::before<A>());
+
+		ok &= expect("before<A>", order(), "cab");
+	}
+
+	{
+		A a(log); B b(log); C c(log);
+		a.subscribe(el::after<B>()); b.subscribe(); c.subscribe();
+
+		ok &= expect("after<B>", order(), "bac");
+	}
+
+	{
+		A a(log); B b(log);
+		a.subscribe(el::Priority{ 5 }); b.subscribe(el::before<A>());
+
+		ok &= expect("constraints win over priorities", order(), "ba");
+	}
+
+	{
+		A a(log); B b(log);
+		a.subscribe(el::Phase::Pre); b.subscribe(el::before<A>());
+
+		ok &= expect("constraints stay within their phase", order(), "ab");
+	}
+
+	{
+		std::vector<el::OrderCycle> cycles;
+
+		EM.setOrderCycleCallback(
+			[&](el::OrderCycle const& cycle)
+			{
+				cycles.push_back(cycle);
+			}
+		);
+
+		A a(log); B b(log); C c(log);
+		a.subscribe(el::before<B>()); b.subscribe(el::before<A>()); c.subscribe();
+
+		ok &= expect("cycle", order(), "bac");
+		ok &= expect("cycle, unchanged", order(), "bac");
+
+		bool reported = cycles.size() == 1
+			&& cycles[0].event == typeid(E_Order)
+			&& cycles[0].phase == el::Phase::Main
+			&& cycles[0].receivers.size() == 2
+			&& *cycles[0].receivers[0] != *cycles[0].receivers[1];
+
+		if (!reported)
+		{
+			std::printf("cycle: expected one report of A and B, got %zu reports\n", cycles.size());
+			ok = false;
+		}
+
+		EM.setOrderCycleCallback({});
+	}
+
+	return ok;
+}
+
+void print(Log const& log, size_t at)
+{
+	size_t from = at > 8 ? at - 8 : 0;
+
+	for (size_t i = from; i < std::min(at + 4, log.size()); i++)
+	{
+		auto& entry = log[i];
+
+		std::printf("%s %6zu: ", i == at ? ">" : " ", i);
+
+		if (entry.receiver == PublishBegin)
+			std::printf("publish E_Stress<%u> {\n", entry.type);
+		else if (entry.receiver == PublishEnd)
+			std::printf("} E_Stress<%u>\n", entry.type);
+		else
+			std::printf("  receiver %u gets E_Stress<%u>\n", entry.receiver, entry.type);
+	}
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	using Clock = std::chrono::steady_clock;
+
+	double		seconds	= argc > 1 ? std::atof(argv[1]) : 5.0;
+	uint64_t	seed	= argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 1;
+
+	uint64_t	operations	= 0;
+	double		busTime		= 0;
+	uint64_t	rounds		= 0;
+
+	if (!checkOrdering())
+		return 1;
+
+	auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+
+	do
+	{
+		auto roundSeed = seed + rounds;
+
+		auto begin = Clock::now();
+
+		Driver<RealBus> real(roundSeed);
+		auto actual = real.run();
+
+		busTime += std::chrono::duration<double>(Clock::now() - begin).count();
+
+		Driver<ModelBus> model(roundSeed);
+		auto expected = model.run();
+
+		operations += real.operations;
+		rounds++;
+
+		if (actual != expected)
+		{
+			size_t at = 0;
+			while (at < actual.size() && at < expected.size() && actual[at] == expected[at])
+				at++;
+
+			std::printf("mismatch in round seed %llu at entry %zu\nexpected:\n", static_cast<unsigned long long>(roundSeed), at);
+			print(expected, at);
+			std::printf("actual:\n");
+			print(actual, at);
+
+			return 1;
+		}
+	}
+	while (Clock::now() < end);
+
+	std::printf("%llu rounds, %llu operations, %.2f M operations/s on the bus: ok\n",
+		static_cast<unsigned long long>(rounds),
+		static_cast<unsigned long long>(operations),
+		static_cast<double>(operations) / busTime / 1e6);
+
+	return 0;
+}
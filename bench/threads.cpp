@@ -0,0 +1,338 @@
+/*
+
+Scalability of publishing from many threads. The bus itself is single-threaded, so two ways of
+sharing it are compared while the number of producer threads grows from 1 to 64:
+
+	locked	every publish holds one global mutex and runs on the producer thread
+	queued	producers append to a mutex-protected queue; consumer threads (1 to 64 as well) take
+			batches from it and publish them, holding the bus mutex for each publish
+
+Both run a contended workload (every producer publishes the same event type) and a spread one
+(producers publish to 16 event types). Reported: events/s, the latency from the publish request
+to the first handler (p50, p99, p99.9) and CPU utilization (process CPU time / wall time).
+
+Usage: bench_threads [events = 400000] [max threads = 64]
+
+The maximum applies to producers and consumers alike.
+
+*/
+
+#include <EventManager/EventManager.hpp>
+#include <EventManager/Histogram.hpp>
+
+#include "Bench.hpp"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t SpreadTypes			= 16;
+constexpr uint32_t SubscribersPerType	= 4;
+
+inline uint64_t now()
+{
+	return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count());
+}
+
+template <uint32_t I>
+struct E_Work : el::EventBase
+{
+	uint64_t sent{};
+};
+
+// Latencies of the thread running the handlers
+thread_local el::Histogram* t_latencies = nullptr;
+
+class Receiver : public el::EventReceiver
+{
+public:
+	uint64_t sum{};
+
+	explicit Receiver(bool first) :
+		m_first(first)
+	{
+		subscribe(std::make_integer_sequence<uint32_t, SpreadTypes>());
+	}
+
+private:
+	bool m_first;
+
+	template <uint32_t... I>
+	void subscribe(std::integer_sequence<uint32_t, I...>)
+	{
+		(EM.subscribe(*this, &Receiver::on<I>), ...);
+	}
+
+	template <uint32_t I>
+	void on(E_Work<I> const& e)
+	{
+		if (m_first)
+			t_latencies->record(now() - e.sent);
+
+		sum += e.sent & 1;
+	}
+};
+
+using Publish = void(*)(uint64_t sent);
+
+template <uint32_t I>
+void publish(uint64_t sent)
+{
+	E_Work<I> e;
+	e.sent = sent;
+
+	el::EventManager::get().publish(std::move(e));
+}
+
+auto const g_publish = []<uint32_t... I>(std::integer_sequence<uint32_t, I...>)
+{
+	return std::array<Publish, SpreadTypes>{ &publish<I>... };
+}(std::make_integer_sequence<uint32_t, SpreadTypes>());
+
+enum class Mode
+{
+	Locked,
+	Queued
+};
+
+struct Measurement
+{
+	double			seconds{};
+	double			cpuSeconds{};
+	el::Histogram	latencies;
+};
+
+Measurement runLocked(uint32_t threads, uint64_t events, bool spread)
+{
+	std::mutex					bus;
+	std::vector<el::Histogram>	latencies(threads);
+	std::vector<std::thread>	producers;
+	std::atomic<bool>			go{};
+
+	for (uint32_t t = 0; t < threads; t++)
+	{
+		producers.emplace_back(
+			[&, t]
+			{
+				t_latencies = &latencies[t];
+
+				auto publish = g_publish[spread ? t % SpreadTypes : 0];
+
+				while (!go.load(std::memory_order_acquire))
+					std::this_thread::yield();
+
+				for (uint64_t i = t; i < events; i += threads)
+				{
+					auto sent = now();
+
+					std::lock_guard lock(bus);
+					publish(sent);
+				}
+			}
+		);
+	}
+
+	Measurement result;
+
+	auto cpu	= std::clock();
+	auto begin	= Clock::now();
+
+	go.store(true, std::memory_order_release);
+
+	for (auto& producer : producers)
+		producer.join();
+
+	result.seconds		= std::chrono::duration<double>(Clock::now() - begin).count();
+	result.cpuSeconds	= static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC;
+
+	for (auto& histogram : latencies)
+		result.latencies.merge(histogram);
+
+	return result;
+}
+
+Measurement runQueued(uint32_t threads, uint32_t consumerCount, uint64_t events, bool spread)
+{
+	struct Request
+	{
+		Publish		publish;
+		uint64_t	sent;
+	};
+
+	std::mutex					mutex;
+	std::condition_variable		ready;
+	std::vector<Request>		queue;
+	uint32_t					running = threads;
+	std::mutex					bus;
+	std::vector<el::Histogram>	latencies(consumerCount);
+	std::vector<std::thread>	consumers;
+	std::vector<std::thread>	producers;
+	std::atomic<bool>			go{};
+
+	Measurement result;
+
+	for (uint32_t c = 0; c < consumerCount; c++)
+	{
+		consumers.emplace_back(
+			[&, c]
+			{
+				t_latencies = &latencies[c];
+
+				std::vector<Request> batch;
+
+				for (;;)
+				{
+					{
+						std::unique_lock lock(mutex);
+						ready.wait(lock, [&] { return !queue.empty() || !running; });
+
+						if (queue.empty())
+							return;
+
+						batch.swap(queue);
+					}
+
+					for (auto& request : batch)
+					{
+						std::lock_guard lock(bus);
+						request.publish(request.sent);
+					}
+
+					batch.clear();
+				}
+			}
+		);
+	}
+
+	for (uint32_t t = 0; t < threads; t++)
+	{
+		producers.emplace_back(
+			[&, t]
+			{
+				auto publish = g_publish[spread ? t % SpreadTypes : 0];
+
+				while (!go.load(std::memory_order_acquire))
+					std::this_thread::yield();
+
+				for (uint64_t i = t; i < events; i += threads)
+				{
+					{
+						std::lock_guard lock(mutex);
+						queue.push_back({ publish, now() });
+					}
+
+					ready.notify_one();
+				}
+
+				std::lock_guard lock(mutex);
+
+				if (!--running)
+					ready.notify_all();
+			}
+		);
+	}
+
+	auto cpu	= std::clock();
+	auto begin	= Clock::now();
+
+	go.store(true, std::memory_order_release);
+
+	for (auto& producer : producers)
+		producer.join();
+
+	for (auto& consumer : consumers)
+		consumer.join();
+
+	result.seconds		= std::chrono::duration<double>(Clock::now() - begin).count();
+	result.cpuSeconds	= static_cast<double>(std::clock() - cpu) / CLOCKS_PER_SEC;
+
+	for (auto& histogram : latencies)
+		result.latencies.merge(histogram);
+
+	return result;
+}
+
+// Locked publishes on the producers, without consumer threads
+std::vector<uint32_t> consumerCounts(Mode mode, uint32_t maxThreads)
+{
+	if (mode == Mode::Locked)
+		return { 0 };
+
+	std::vector<uint32_t> counts;
+
+	for (uint32_t consumers = 1; consumers <= maxThreads; consumers *= 2)
+		counts.push_back(consumers);
+
+	return counts;
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+	bench::init(argc, argv);
+
+	uint64_t events		= argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 400'000;
+	uint32_t maxThreads	= argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 64;
+
+	std::printf("%llu events per run, %u hardware threads\n\n", static_cast<unsigned long long>(events), std::thread::hardware_concurrency());
+
+	std::vector<std::unique_ptr<Receiver> > receivers;
+
+	for (uint32_t i = 0; i < SubscribersPerType; i++)
+		receivers.push_back(std::make_unique<Receiver>(i == 0));
+
+	std::printf("%-6s %-10s %9s %9s %14s %10s %10s %10s %8s\n", "mode", "workload", "producers", "consumers", "events/s", "p50 us", "p99 us", "p99.9 us", "cpu %");
+
+	for (auto mode : { Mode::Locked, Mode::Queued })
+	{
+		for (bool spread : { false, true })
+		{
+			for (uint32_t threads = 1; threads <= maxThreads; threads *= 2)
+			{
+				for (uint32_t consumers : consumerCounts(mode, maxThreads))
+				{
+					auto m = mode == Mode::Locked ? runLocked(threads, events, spread) : runQueued(threads, consumers, events, spread);
+
+					auto us = [&](double fraction)
+					{
+						return static_cast<double>(m.latencies.percentile(fraction)) / 1e3;
+					};
+
+					char const* modeName	= mode == Mode::Locked ? "locked" : "queued";
+					char const* workload	= spread ? "spread" : "contended";
+
+					std::printf("%-6s %-10s %9u %9u %14.0f %10.2f %10.2f %10.2f %8.0f\n", modeName, workload, threads, consumers,
+						static_cast<double>(events) / m.seconds, us(0.5), us(0.99), us(0.999), m.cpuSeconds / m.seconds * 100);
+
+					auto name = std::string(modeName) + ", " + workload + ", " + std::to_string(threads) + " threads";
+
+					if (mode == Mode::Queued)
+						name += ", " + std::to_string(consumers) + " consumers";
+
+					// ns per event, so that bench_compare can gate on it
+					bench::report({ name, events, m.seconds * 1e9 / static_cast<double>(events), 0, { m.seconds * 1e9 / static_cast<double>(events) } });
+				}
+			}
+		}
+	}
+
+	for (auto& receiver : receivers)
+		bench::doNotOptimize(receiver->sum);
+
+	return bench::finish();
+}
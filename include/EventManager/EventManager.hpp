@@ -36,11 +36,81 @@ SOFTWARE.
 
 #define EVENT_MANAGER_GET auto& EM = el::EventManager::get
 
+// Define before including to count publishes, handler invocations and early exits per event type.
+// Without it the counters and EventManager::stats() are compiled out.
+// #define EVENT_MANAGER_ENABLE_STATS
+
+// Define before including to record per-handler latency histograms keyed by (event type, receiver type).
+// Each handler invocation then costs two steady_clock reads (a vDSO call, ~20 ns each on x86-64 Linux)
+// and one histogram increment; nothing is allocated on the dispatch path.
+// #define EVENT_MANAGER_ENABLE_HISTOGRAMS
+
+// Define before including to record publish, handler and action spans while el::Tracer is running.
+// When the tracer is stopped each publish and handler costs one relaxed atomic load.
+// #define EVENT_MANAGER_ENABLE_TRACING
+
+// Define before including to report handlers and actions that run longer than a threshold (EventManager::setWatchdog).
+// Costs one hash lookup per publish, plus two clock reads per call while a threshold is set for the event type.
+// #define EVENT_MANAGER_ENABLE_WATCHDOG
+
+// Define before including to read Linux perf_event counters (instructions, cycles, cache and branch misses, or
+// task-clock and page faults without hardware counters) around every sampled handler call (EventManager::perfCounters).
+// Costs one rdpmc per counter per read, or one read() system call for the group when rdpmc is not permitted.
+// #define EVENT_MANAGER_ENABLE_PERF_COUNTERS
+
+// Define before including to timestamp scheduled actions: EventManager::pendingActions() then reports the age of
+// the oldest pending action per type, and EventManager::setActionMaxAge() reports or drops actions that wait too long.
+// Costs one steady_clock read per schedule() and one per top-level publish while a max age is set.
+// #define EVENT_MANAGER_ENABLE_ACTION_AGES
+
+// Define as a default-constructible type with the hooks of el::NullObserver, declared before including,
+// to observe the bus lifecycle (profiler zones, counters). The default observer compiles to nothing.
+// #define EVENT_MANAGER_OBSERVER MyObserver
+
+#if defined(EVENT_MANAGER_ENABLE_HISTOGRAMS) || defined(EVENT_MANAGER_ENABLE_TRACING) || defined(EVENT_MANAGER_ENABLE_PERF_COUNTERS)
+	#define EVENT_MANAGER_INTERNAL_SAMPLING
+#endif
+
+#if defined(EVENT_MANAGER_INTERNAL_SAMPLING) || defined(EVENT_MANAGER_ENABLE_WATCHDOG) || defined(EVENT_MANAGER_ENABLE_ACTION_AGES)
+	#define EVENT_MANAGER_INTERNAL_TIMING
+#endif
+
+#include "TypeName.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <functional>
 #include <memory>
 #include <list>
+#include <map>
+#include <span>
+#include <sstream>
 #include <unordered_map>
+#include <unordered_set>
 #include <typeindex>
+#include <typeinfo>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#ifdef EVENT_MANAGER_INTERNAL_TIMING
+	#include <chrono>
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+	#include "Histogram.hpp"
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+	#include "Trace.hpp"
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_PERF_COUNTERS
+	#include "PerfCounters.hpp"
+#endif
 
 namespace el
 {
@@ -59,6 +129,207 @@ protected:
 	EventBase() = default;
 };
 
+// Wildcard handler: gets every published event with its type
+using AnyEventAction = std::function<void(std::type_info const& type, EventBase const& e)>;
+
+// Receivers with a higher priority are notified first, equal priorities in subscription order
+struct Priority
+{
+	int32_t value{};
+};
+
+// Segments of one publish, notified in this order; a receiver may subscribe once per phase
+enum class Phase : uint8_t
+{
+	Pre,
+	Main,
+	Post
+};
+
+constexpr size_t PhaseCount = 3;
+
+constexpr size_t GroupCount = 64;
+
+// Subscriptions of a paused group stay in place but are skipped by publish and query
+struct Group
+{
+	uint8_t index{};	// group 0 by default
+
+	constexpr Group() = default;
+
+	// An index of GroupCount or more is rejected in release builds too: it does not compile
+	// in a constant expression and aborts otherwise, instead of aliasing another group
+	constexpr Group(uint8_t theIndex) :
+		index(theIndex)
+	{
+		if (theIndex >= GroupCount)
+			outOfRange(theIndex);
+	}
+
+private:
+	[[noreturn]] static void outOfRange(uint8_t index)
+	{
+		std::fprintf(stderr, "el::Group index %u is out of range, the limit is %zu\n", static_cast<unsigned>(index), GroupCount);
+		std::abort();
+	}
+};
+
+enum class CallKind : uint8_t
+{
+	Handler,
+	UrgentAction,
+	EventAction
+};
+
+// Default observer: every hook is an empty inline function
+struct NullObserver
+{
+	inline void onPublishBegin(std::type_index /*event*/) { }
+	inline void onPublishEnd(std::type_index /*event*/) { }
+
+	inline void onHandlerBegin(std::type_index /*event*/, void* /*receiver*/, std::type_info const& /*receiverType*/) { }
+	inline void onHandlerEnd(std::type_index /*event*/, void* /*receiver*/, std::type_info const& /*receiverType*/) { }
+
+	inline void onSubscribe(std::type_index /*event*/, void* /*receiver*/) { }
+	inline void onUnsubscribe(std::type_index /*event*/, void* /*receiver*/) { }
+
+	// Urgent actions are scheduled without an event type, typeid(void) is passed for them
+	inline void onSchedule(CallKind /*kind*/, std::type_index /*event*/) { }
+
+	// For urgent actions, event is the event whose publish runs them
+	inline void onActionBegin(CallKind /*kind*/, std::type_index /*event*/) { }
+	inline void onActionEnd(CallKind /*kind*/, std::type_index /*event*/) { }
+};
+
+#ifdef EVENT_MANAGER_OBSERVER
+using Observer = EVENT_MANAGER_OBSERVER;
+#else
+using Observer = NullObserver;
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+struct HandlerLatency
+{
+	std::type_index		event;
+	std::type_index		receiver;
+	Histogram const&	histogram;	// nanoseconds
+};
+#endif
+
+enum class CascadeIssue : uint8_t
+{
+	Cycle,		// an event type is published again while it is being published
+	DepthLimit	// the publish was dropped because the maximum depth was reached
+};
+
+struct Cascade
+{
+	CascadeIssue issue;
+
+	// Event types being published, outermost first; the last one caused the report
+	std::span<std::type_info const* const> chain;
+
+	// E.g. "App::E_A -> App::E_B -> App::E_A"
+	inline std::string describe() const
+	{
+		std::string result;
+
+		for (auto type : chain)
+		{
+			if (!result.empty())
+				result += " -> ";
+
+			result += typeName(*type);
+		}
+
+		return result;
+	}
+};
+
+using CascadeCallback = std::function<void(Cascade const&)>;
+
+enum class TopologyFormat : uint8_t
+{
+	Dot,	// Graphviz
+	Json
+};
+
+#ifdef EVENT_MANAGER_ENABLE_WATCHDOG
+struct SlowCall
+{
+	CallKind				kind;
+	std::type_info const&	event;			// for urgent actions, the event whose publish ran them
+	void*					receiver;		// nullptr for actions
+	std::type_info const*	receiverType;	// nullptr for actions
+
+	std::chrono::nanoseconds elapsed;
+
+	inline std::string eventName() const
+	{
+		return typeName(event);
+	}
+
+	inline std::string receiverName() const
+	{
+		return receiverType ? typeName(*receiverType) : std::string();
+	}
+};
+
+using SlowCallCallback = std::function<void(SlowCall const&)>;
+#endif
+
+// Actions waiting for a publish, see EventManager::pendingActions
+struct PendingActions
+{
+	CallKind		kind;		// UrgentAction or EventAction
+	std::type_index	event;		// typeid(void) for urgent actions
+	size_t			count{};
+
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+	std::chrono::nanoseconds oldest{};	// age of the oldest pending action
+#endif
+};
+
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+enum class StaleActionPolicy : uint8_t
+{
+	Report,	// report every stale action once and keep it
+	Drop	// report and destroy stale actions, releasing their captures
+};
+
+struct StaleAction
+{
+	CallKind					kind;
+	std::type_index				event;		// typeid(void) for urgent actions
+	std::chrono::nanoseconds	age;
+	bool						dropped;
+};
+
+using StaleActionCallback = std::function<void(StaleAction const&)>;
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_PERF_COUNTERS
+struct HandlerPerf
+{
+	std::type_index		event;
+	std::type_index		receiver;
+	PerfTotals const&	totals;
+};
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_STATS
+struct EventStats
+{
+	std::type_index	type;
+
+	uint64_t	publishes{};		// number of publish() calls
+	uint64_t	invocations{};		// total handler calls
+	uint64_t	handledEarly{};		// dispatches stopped by EventBase::handled
+	size_t		subscribers{};		// current number of subscriptions, a receiver counts once per phase
+	size_t		pendingActions{};	// event actions waiting for the next publish
+};
+#endif
+
 class EventReceiver;
 
 template <typename T>
@@ -67,334 +338,2284 @@ concept DerivedFromEventBase = std::derived_from<T, EventBase>;
 template <typename T>
 concept DerivedFromEventReceiver = std::derived_from<T, EventReceiver>;
 
+enum class Relation : uint8_t
+{
+	Before,
+	After
+};
+
+// Orders a subscription against the other subscribers of the same event type and phase; constraints win over priorities
+struct Constraint
+{
+	Relation				relation;
+	std::type_info const*	receiverType;	// every subscription of this receiver type (EventStats naming),
+	void const*				receiver;		// or of this receiver when not null
+};
+
+template <DerivedFromEventReceiver Receiver>
+inline Constraint before()
+{
+	return { Relation::Before, &typeid(Receiver), nullptr };
+}
+
+template <DerivedFromEventReceiver Receiver>
+inline Constraint after()
+{
+	return { Relation::After, &typeid(Receiver), nullptr };
+}
+
+inline Constraint before(EventReceiver const& receiver)
+{
+	return { Relation::Before, nullptr, &receiver };
+}
+
+inline Constraint after(EventReceiver const& receiver)
+{
+	return { Relation::After, nullptr, &receiver };
+}
+
+template <typename T>
+concept SubscribeOption = std::same_as<T, Phase> || std::same_as<T, Priority> || std::same_as<T, Constraint> || std::same_as<T, Group>;
+
+// Subscriptions whose constraints contradict each other; they are notified in priority order instead
+struct OrderCycle
+{
+	std::type_index						event;
+	Phase								phase;
+	std::vector<std::type_info const*>	receivers;	// receiver types along the cycle
+};
+
+using OrderCycleCallback = std::function<void(OrderCycle const&)>;
+
+// Collectors for EventManager::query; a collector is called with every result and may return false to stop the query
+
+template <typename Result>
+struct Sum
+{
+	Result value{};
+
+	inline void operator () (Result&& result)
+	{
+		value += result;
+	}
+};
+
+template <typename Result>
+struct Min
+{
+	Result	value{};
+	bool	found{};
+
+	inline void operator () (Result&& result)
+	{
+		if (!found || result < value)
+			value = std::move(result);
+
+		found = true;
+	}
+};
+
+// Stops at the first result that converts to true
+template <typename Result>
+struct FirstNonNull
+{
+	Result value{};
+
+	inline bool operator () (Result&& result)
+	{
+		if (!result)
+			return true;
+
+		value = std::move(result);
+		return false;
+	}
+};
+
+// Stores the results into a caller-provided buffer, stops once it is full
+template <typename Result>
+struct Append
+{
+	std::span<Result>	buffer;
+	size_t				size{};
+
+	explicit Append(std::span<Result> theBuffer) :
+		buffer(theBuffer) { }
+
+	inline bool operator () (Result&& result)
+	{
+		if (size < buffer.size())
+			buffer[size++] = std::move(result);
+
+		return size < buffer.size();
+	}
+
+	inline std::span<Result> results() const
+	{
+		return buffer.first(size);
+	}
+};
+
 namespace internal
 {
 
-	class EventHandler
+	inline Observer& observer()
+	{
+		static Observer instance;
+		return instance;
+	}
+
+#ifdef EVENT_MANAGER_INTERNAL_TIMING
+	inline uint64_t now()
+	{
+		using namespace std::chrono;
+
+		return static_cast<uint64_t>(duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count());
+	}
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_WATCHDOG
+	class Watchdog
 	{
 	public:
-		EventHandler()          = default;
-		virtual ~EventHandler() = default;
+		inline static Watchdog& get()
+		{
+			static Watchdog instance;
+			return instance;
+		}
+
+		// Threshold in nanoseconds for the event type, 0 when the watchdog is off for it
+		inline uint64_t threshold(std::type_info const& tid) const
+		{
+			if (!m_perType.empty())
+			{
+				auto entry = m_perType.find(tid);
+				if (entry != m_perType.end())
+					return entry->second;
+			}
+
+			return m_global;
+		}
+
+		inline void check(CallKind kind, std::type_info const& tid, void* receiver, std::type_info const* receiverType, uint64_t elapsed, uint64_t threshold) const
+		{
+			if (elapsed >= threshold && m_callback)
+				m_callback({ kind, tid, receiver, receiverType, std::chrono::nanoseconds(elapsed) });
+		}
+
+		inline void setGlobal(uint64_t threshold)
+		{
+			m_global = threshold;
+		}
+
+		inline void setFor(std::type_info const& tid, uint64_t threshold)
+		{
+			m_perType[tid] = threshold;
+		}
+
+		inline void resetFor(std::type_info const& tid)
+		{
+			m_perType.erase(tid);
+		}
 
-		virtual void handle(void* handler, EventBase const& e) const = 0;
+		inline void setCallback(SlowCallCallback&& callback)
+		{
+			m_callback = std::move(callback);
+		}
+
+	private:
+		uint64_t									m_global{};
+		std::unordered_map<std::type_index, uint64_t>	m_perType;
+		SlowCallCallback							m_callback;
 	};
+#endif
 
-	template <DerivedFromEventReceiver R, DerivedFromEventBase E>
-	class MethodEventHandler : public EventHandler
+#ifdef EVENT_MANAGER_INTERNAL_SAMPLING
+	// Picks the top-level publishes whose handler timings and spans are recorded;
+	// nested publishes follow the decision of the publish they are nested in
+	class Sampler
 	{
 	public:
-		using Method = void(R::*)(E const&);
+		inline static Sampler& get()
+		{
+			static Sampler instance;
+			return instance;
+		}
 
-		MethodEventHandler(Method method) : 
-			m_method(method) { }
+		inline bool sample(bool topLevel)
+		{
+			if (topLevel)
+				m_current = decide();
+
+			return m_current;
+		}
+
+		// Record one publish out of every n, 1 records all of them
+		inline void setEvery(uint32_t n)
+		{
+			m_every     = std::max<uint32_t>(n, 1);
+			m_countdown = 1;
+		}
+
+		// Record at most one publish per interval, 0 turns the interval off
+		inline void setInterval(uint64_t interval)
+		{
+			m_interval = interval;
+			m_next     = 0;
+		}
+
+	private:
+		uint32_t	m_every = 1;
+		uint32_t	m_countdown = 1;
+		uint64_t	m_interval{};	// nanoseconds
+		uint64_t	m_next{};
+		bool		m_current = true;
+
+		inline bool decide()
+		{
+			if (--m_countdown)
+				return false;
+
+			m_countdown = m_every;
+
+			if (m_interval)
+			{
+				auto time = now();
+				if (time < m_next)
+					return false;
 
-		void handle(void* handler, EventBase const& e) const final
+				m_next = time + m_interval;
+			}
+
+			return true;
+		}
+	};
+#endif
+
+	// What a publish measures, decided once per publish; empty when instrumentation is compiled out
+	struct Probe
+	{
+#ifdef EVENT_MANAGER_INTERNAL_SAMPLING
+		bool sampled{};
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+		bool trace{};
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_WATCHDOG
+		uint64_t slowAfter{};	// watchdog threshold in nanoseconds
+#endif
+
+		Probe([[maybe_unused]] std::type_info const& tid, [[maybe_unused]] bool topLevel)
+		{
+#ifdef EVENT_MANAGER_INTERNAL_SAMPLING
+			sampled = Sampler::get().sample(topLevel);
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+			trace = sampled && Tracer::active();
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_WATCHDOG
+			slowAfter = Watchdog::get().threshold(tid);
+#endif
+		}
+
+		// Whether individual calls have to be timed
+		inline bool timed() const
+		{
+			bool result = false;
+
+#if defined(EVENT_MANAGER_ENABLE_HISTOGRAMS) || defined(EVENT_MANAGER_ENABLE_PERF_COUNTERS)
+			result |= sampled;
+#elif defined(EVENT_MANAGER_ENABLE_TRACING)
+			result |= trace;
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_WATCHDOG
+			result |= slowAfter != 0;
+#endif
+
+			return result;
+		}
+	};
+
+	struct ScheduledAction
+	{
+		Action action;
+
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+		uint64_t	scheduled = now();
+		bool		reported{};
+#endif
+	};
+
+	using ActionList = std::list<ScheduledAction>;
+
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+	// Age of the oldest action, actions are kept in scheduling order
+	inline std::chrono::nanoseconds oldest(ActionList const& actions, uint64_t time)
+	{
+		return std::chrono::nanoseconds(actions.empty() ? 0 : time - actions.front().scheduled);
+	}
+
+	// Collect the actions older than maxAge, moving them to dropped if drop is set.
+	// Reported actions are not reported again.
+	inline void collectStale(ActionList& actions, CallKind kind, std::type_index tid, uint64_t time, uint64_t maxAge,
+		bool drop, std::vector<StaleAction>& stale, ActionList& dropped)
+	{
+		auto action = actions.begin();
+
+		for (; action != actions.end() && time - action->scheduled > maxAge; ++action)
+		{
+			if (!action->reported || drop)
+				stale.push_back({ kind, tid, std::chrono::nanoseconds(time - action->scheduled), drop });
+
+			action->reported = true;
+		}
+
+		if (drop)
+			dropped.splice(dropped.end(), actions, actions.begin(), action);
+	}
+#endif
+
+	// Run a scheduled action, timing it for the watchdog if needed
+	inline void run(Action const& action, CallKind kind, std::type_info const& tid, [[maybe_unused]] Probe const& probe)
+	{
+		observer().onActionBegin(kind, tid);
+
+#ifdef EVENT_MANAGER_ENABLE_WATCHDOG
+		if (probe.slowAfter)
+		{
+			auto begin = now();
+
+			action();
+
+			Watchdog::get().check(kind, tid, nullptr, nullptr, now() - begin, probe.slowAfter);
+		}
+		else
+#endif
+		action();
+
+		observer().onActionEnd(kind, tid);
+	}
+
+	constexpr uint64_t groupBit(Group group)
+	{
+		return uint64_t(1) << group.index;
+	}
+
+	// Type-erased reference to a query collector; false from call stops the query
+	template <typename Result>
+	struct Fold
+	{
+		void*	collector;
+		bool	(*call)(void* collector, Result&& value);
+	};
+
+	struct SubscribeOptions
+	{
+		Phase					phase = Phase::Main;
+		Priority				priority;
+		Group					group;
+		std::vector<Constraint>	constraints;
+
+		inline void set(Phase value)
+		{
+			phase = value;
+		}
+
+		inline void set(Priority value)
+		{
+			priority = value;
+		}
+
+		inline void set(Constraint const& value)
 		{
-			(static_cast<R*>(handler)->*m_method)(static_cast<E const&>(e));
+			constraints.push_back(value);
 		}
 
-	private:
-		Method m_method{};
-	};
+		inline void set(Group value)
+		{
+			group = value;
+		}
+	};
+
+	class EventHandler
+	{
+	public:
+		// Static type for method handlers, dynamic type at subscription time for lambdas
+		std::type_info const& receiverType;
+
+#ifdef EVENT_MANAGER_ENABLE_STATS
+		uint64_t* calls{};
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+		Histogram* latency{};
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_PERF_COUNTERS
+		PerfTotals* perf{};
+#endif
+
+		// Return type for handlers that answer queries, null for void handlers
+		std::type_info const* result{};
+
+		EventHandler(std::type_info const& theReceiverType, std::type_info const* theResult = nullptr) :
+			receiverType(theReceiverType), result(theResult) { }
+
+		virtual ~EventHandler() = default;
+
+		virtual void handle(void* handler, EventBase const& e, std::type_info const& tid) const = 0;
+
+		// Passes the result to a Fold<Result> when result is typeid(Result), returns false to stop the query
+		virtual bool answer(void* /*handler*/, EventBase const& /*e*/, void const* /*fold*/) const
+		{
+			return true;
+		}
+	};
+
+	template <typename Result>
+	inline std::type_info const* resultType()
+	{
+		if constexpr (std::is_void_v<Result>)
+			return nullptr;
+		else
+			return &typeid(Result);
+	}
+
+	template <DerivedFromEventReceiver R, DerivedFromEventBase E, typename Result = void>
+	class MethodEventHandler : public EventHandler
+	{
+	public:
+		using Method = Result(R::*)(E const&);
+
+		MethodEventHandler(Method method) : 
+			EventHandler(typeid(R), resultType<Result>()), m_method(method) { }
+
+		void handle(void* handler, EventBase const& e, std::type_info const&) const final
+		{
+			(receiver(handler)->*m_method)(static_cast<E const&>(e));
+		}
+
+		bool answer(void* handler, EventBase const& e, void const* fold) const final
+		{
+			if constexpr (std::is_void_v<Result>)
+				return true;
+			else
+			{
+				auto& to = *static_cast<Fold<Result> const*>(fold);
+				return to.call(to.collector, (receiver(handler)->*m_method)(static_cast<E const&>(e)));
+			}
+		}
+
+	private:
+		Method m_method{};
+
+		// Receivers are stored as EventReceiver*, which is not R*'s address when EventReceiver is not the first base
+		static inline R* receiver(void* handler)
+		{
+			return static_cast<R*>(static_cast<EventReceiver*>(handler));
+		}
+	};
+
+	template <DerivedFromEventBase E, typename Result = void>
+	class LambdaEventHandler : public EventHandler
+	{
+	public:
+		using Lambda = std::function<Result(E const&)>;
+
+		LambdaEventHandler(std::type_info const& receiverType, Lambda&& lambda) : 
+			EventHandler(receiverType, resultType<Result>()), m_lambda(std::move(lambda)) { }
+
+		void handle(void*, EventBase const& e, std::type_info const&) const final
+		{
+			m_lambda(static_cast<E const&>(e));
+		}
+
+		bool answer(void*, EventBase const& e, void const* fold) const final
+		{
+			if constexpr (std::is_void_v<Result>)
+				return true;
+			else
+			{
+				auto& to = *static_cast<Fold<Result> const*>(fold);
+				return to.call(to.collector, m_lambda(static_cast<E const&>(e)));
+			}
+		}
+
+	private:
+		Lambda m_lambda{};
+	};
+
+	class AnyEventHandler : public EventHandler
+	{
+	public:
+		AnyEventHandler(std::type_info const& receiverType, AnyEventAction&& action) :
+			EventHandler(receiverType), m_action(std::move(action)) { }
+
+		void handle(void*, EventBase const& e, std::type_info const& tid) const final
+		{
+			m_action(tid, e);
+		}
+
+	private:
+		AnyEventAction m_action{};
+	};
+
+	class EventHandlerList
+	{
+	public:
+		using Handler = std::unique_ptr<EventHandler>;
+
+		EventHandlerList() = default;
+
+		inline void dispatch(std::type_info const& tid, EventBase const& e, [[maybe_unused]] Probe const& probe, uint64_t const& activeGroups, OrderCycleCallback const& onCycle)
+		{
+#ifdef EVENT_MANAGER_ENABLE_STATS
+			m_stats.publishes++;
+#endif
+
+			walk(tid, activeGroups, onCycle,
+				[&](Entry const& entry)
+				{
+					invoke(tid, entry, e, probe);
+
+#ifdef EVENT_MANAGER_ENABLE_STATS
+					m_stats.invocations++;
+
+					if (e.handled)
+						m_stats.handledEarly++;
+#endif
+
+					return !e.handled;
+				}
+			);
+		}
+
+		// Folds the results of the handlers returning Result, returns their number
+		template <typename Result>
+		inline size_t query(std::type_info const& tid, EventBase const& e, Fold<Result> const& fold, uint64_t const& activeGroups, OrderCycleCallback const& onCycle)
+		{
+			size_t answers = 0;
+
+			walk(tid, activeGroups, onCycle,
+				[&](Entry const& entry)
+				{
+					auto& handler = *entry.handler;
+
+					if (!handler.result || *handler.result != typeid(Result))
+						return true;
+
+					answers++;
+
+					return handler.answer(entry.receiver, e, &fold) && !e.handled;
+				}
+			);
+
+			return answers;
+		}
+
+		// Returns false if the receiver is already subscribed in this phase
+		template <DerivedFromEventReceiver R, DerivedFromEventBase E, typename Result>
+		constexpr bool add(EventReceiver* receiver, Result(R::* method)(E const&), SubscribeOptions&& options)
+		{
+			auto& subscription = m_handlers[receiver];
+			if (subscription.subscribed(options.phase))
+				return false;
+
+			insert(subscription, receiver, std::make_unique<MethodEventHandler<R, E, Result> >(method), std::move(options));
+			return true;
+		}
+
+		// Returns false if the receiver is already subscribed in this phase
+		template <DerivedFromEventBase E, typename Result = void>
+		constexpr bool add(void* receiver, std::type_info const& receiverType, std::function<Result(E const&)>&& lambda, SubscribeOptions&& options)
+		{
+			auto& subscription = m_handlers[receiver];
+			if (subscription.subscribed(options.phase))
+				return false;
+
+			insert(subscription, receiver, std::make_unique<LambdaEventHandler<E, Result> >(receiverType, std::move(lambda)), std::move(options));
+			return true;
+		}
+
+		// Returns false if the receiver is already subscribed in this phase
+		inline bool add(void* receiver, std::type_info const& receiverType, AnyEventAction&& action, SubscribeOptions&& options)
+		{
+			auto& subscription = m_handlers[receiver];
+			if (subscription.subscribed(options.phase))
+				return false;
+
+			insert(subscription, receiver, std::make_unique<AnyEventHandler>(receiverType, std::move(action)), std::move(options));
+			return true;
+		}
+
+		// Removes the receiver from every phase, returns the number of subscriptions removed
+		inline size_t remove(void* receiver)
+		{
+			auto entry = m_handlers.find(receiver);
+			if (entry == m_handlers.end())
+				return 0;
+
+			auto& subscription	= entry->second;
+			size_t removed		= 0;
+
+			for (size_t phase = 0; phase < PhaseCount; phase++)
+			{
+				if (!subscription.subscribed(static_cast<Phase>(phase)))
+					continue;
+
+				retire(subscription.positions[phase]);
+				removed++;
+			}
+
+			m_handlers.erase(entry);
+
+			return removed;
+		}
+
+		// Identifies one subscription for a Connection; stays valid until that subscription is removed
+		struct Handle
+		{
+			uint32_t	slot{ NoSlot };
+			uint64_t	serial{};
+		};
+
+		// Tracks the receiver's subscription in that phase
+		inline Handle track(void* receiver, Phase phase)
+		{
+			auto position = m_handlers[receiver].positions[static_cast<uint8_t>(phase)];
+
+			if (position->slot == NoSlot)
+			{
+				if (m_freeSlots.empty())
+				{
+					position->slot = static_cast<uint32_t>(m_slots.size());
+					m_slots.push_back(position);
+				}
+
+				else
+				{
+					position->slot = m_freeSlots.back();
+					m_freeSlots.pop_back();
+
+					m_slots[position->slot] = position;
+				}
+			}
+
+			return { position->slot, position->serial };
+		}
+
+		// Removes the tracked subscription in O(1), returns its receiver or nullptr if it is already gone
+		inline void* remove(Handle handle)
+		{
+			auto position = find(handle);
+			if (position == m_order.end())
+				return nullptr;
+
+			auto receiver		= position->receiver;
+			auto entry			= m_handlers.find(receiver);
+			auto& subscription	= entry->second;
+
+			for (uint8_t phase = 0; phase < PhaseCount; phase++)
+			{
+				if (subscription.subscribed(static_cast<Phase>(phase)) && subscription.positions[phase] == position)
+				{
+					subscription.phases &= static_cast<uint8_t>(~(1 << phase));
+					break;
+				}
+			}
+
+			if (!subscription.phases)
+				m_handlers.erase(entry);
+
+			retire(position);
+
+			return receiver;
+		}
+
+		// Returns false if the tracked subscription is already gone
+		inline bool block(Handle handle, bool blocked)
+		{
+			auto position = find(handle);
+			if (position == m_order.end())
+				return false;
+
+			position->blocked = blocked;
+			return true;
+		}
+
+		inline bool blocked(Handle handle)
+		{
+			auto position = find(handle);
+			return position != m_order.end() && position->blocked;
+		}
+
+		inline bool contains(Handle handle)
+		{
+			return find(handle) != m_order.end();
+		}
+
+		inline void clear()
+		{
+			m_handlers    .clear();
+			m_order       .clear();
+			m_bands       .clear();
+			m_constraints .clear();
+			m_slots       .clear();
+			m_freeSlots   .clear();
+
+			m_subscriptions = 0;
+		}
+
+		inline size_t size() const
+		{
+			return m_handlers.size();
+		}
+
+		// Drops the constraints naming this receiver, it is going away
+		inline void forget(void const* receiver)
+		{
+			for (auto it = m_constraints.begin(); it != m_constraints.end(); )
+			{
+				auto& constraints = it->second;
+
+				if (std::erase_if(constraints, [&](Constraint const& constraint) { return constraint.receiver == receiver; }))
+					m_dirty = true;
+
+				if (constraints.empty())
+					it = m_constraints.erase(it);
+				else
+					++it;
+			}
+		}
+
+		// One per subscribed phase of every receiver
+		inline size_t subscriptions() const
+		{
+			return m_subscriptions;
+		}
+
+#ifdef EVENT_MANAGER_ENABLE_STATS
+		struct Stats
+		{
+			uint64_t publishes{};
+			uint64_t invocations{};
+			uint64_t handledEarly{};
+		};
+
+		inline Stats const& stats() const
+		{
+			return m_stats;
+		}
+
+		using CallMap = std::unordered_map<std::type_index, uint64_t>;
+
+		// Handler invocations by receiver type
+		inline CallMap const& calls() const
+		{
+			return m_calls;
+		}
+#endif
+
+		// Calls fn(receiver, handler) for every subscription, in dispatch order
+		template <typename Fn>
+		inline void forEach(Fn&& fn) const
+		{
+			for (auto& entry : m_order)
+				if (entry.serial != Removed)
+					fn(entry.receiver, *entry.handler);
+		}
+
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+		using LatencyMap = std::unordered_map<std::type_index, Histogram>;
+
+		// Handler latencies by receiver type
+		inline LatencyMap const& latencies() const
+		{
+			return m_latencies;
+		}
+
+		inline void resetLatencies()
+		{
+			for (auto& [_, histogram] : m_latencies)
+				histogram.reset();
+		}
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_PERF_COUNTERS
+		using PerfMap = std::unordered_map<std::type_index, PerfTotals>;
+
+		// Counter totals by receiver type
+		inline PerfMap const& perfCounters() const
+		{
+			return m_perf;
+		}
+
+		inline void resetPerfCounters()
+		{
+			for (auto& [_, totals] : m_perf)
+				totals = {};
+		}
+#endif
+
+	private:
+		static constexpr uint64_t Removed = UINT64_MAX;
+		static constexpr uint32_t NoSlot  = UINT32_MAX;
+
+		struct Entry
+		{
+			uint64_t	serial;		// subscription order, Removed once unsubscribed
+			void*		receiver;
+			Handler		handler;
+			int64_t		rank;
+			uint32_t	slot;		// in m_slots when a Connection tracks it, NoSlot otherwise
+			uint8_t		group;		// index of the subscription's group
+			bool		blocked;	// by its Connection
+		};
+
+		using Order = std::list<Entry>;
+
+		// Positions of a receiver's entries, one per phase
+		struct Subscription
+		{
+			std::array<Order::iterator, PhaseCount>	positions;
+			uint8_t									phases{};	// bit per subscribed phase
+
+			inline bool subscribed(Phase phase) const
+			{
+				return phases & (1 << static_cast<uint8_t>(phase));
+			}
+		};
+
+		// Entries of one rank, contiguous in m_order
+		struct Band
+		{
+			Order::iterator	first;
+			size_t			size{};
+		};
+
+		using BandMap = std::map<int64_t, Band>;
+
+		using Sorted = std::vector<Entry*>;
+
+		std::unordered_map<void*, Subscription>						m_handlers;
+		Order														m_order;	// by phase, then descending priority, then serial
+		BandMap														m_bands;
+		uint64_t													m_serial{};
+		size_t														m_subscriptions{};	// live entries of m_order
+		std::vector<Handler>										m_retired;	// removed while dispatching
+		std::unordered_map<Entry const*, std::vector<Constraint> >	m_constraints;
+		std::unique_ptr<Sorted>										m_sorted;	// dispatch order while there are constraints
+		std::vector<std::unique_ptr<Sorted> >						m_retiredOrders;	// replaced while dispatching
+		bool														m_dirty{};	// m_sorted is out of date
+		std::vector<Order::iterator>								m_slots;	// entries tracked by a Connection, end() when free
+		std::vector<uint32_t>										m_freeSlots;
+
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+		LatencyMap m_latencies;	// node-based, so handlers can keep pointers into it
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_PERF_COUNTERS
+		PerfMap m_perf;
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_STATS
+		Stats	m_stats;
+		CallMap	m_calls;	// node-based, so handlers can keep pointers into it
+#endif
+
+		uint32_t	m_executing{};	// depth of nested dispatches of this event type
+		bool		m_needsCleanUp{};
+
+		static inline Entry& at(Entry& entry)
+		{
+			return entry;
+		}
+
+		static inline Entry& at(Entry* entry)
+		{
+			return *entry;
+		}
+
+		static inline Phase phaseOf(Entry const& entry)
+		{
+			return static_cast<Phase>(entry.rank >> 32);
+		}
+
+		// Calls fn(entry) in dispatch order until it returns false; activeGroups is read again for every entry,
+		// so a group paused by a handler is skipped for the rest of the walk
+		template <typename Fn>
+		inline void walk(std::type_info const& tid, uint64_t const& activeGroups, OrderCycleCallback const& onCycle, Fn&& fn)
+		{
+			m_executing++;         // for nested events
+
+			if (m_constraints.empty())
+				walk(m_order, activeGroups, fn);
+
+			else
+			{
+				if (m_dirty)
+					sort(tid, onCycle);
+
+				walk(*m_sorted, activeGroups, fn);
+			}
+
+			m_executing--;         // for nested events
+
+			if (!m_executing)
+				cleanUp();         // for nested events
+		}
+
+		template <typename Range, typename Fn>
+		inline void walk(Range& order, uint64_t const& activeGroups, Fn& fn)
+		{
+			// Receivers subscribed meanwhile have a later serial and only get the next publish;
+			// removed ones stay in the list as Removed until the outermost dispatch ends
+			auto last = m_serial;
+
+			for (auto& item : order)
+			{
+				auto& entry = at(item);
+
+				if (entry.serial > last || entry.blocked || !((activeGroups >> entry.group) & 1))
+					continue;
+
+				if (!fn(entry))
+					break;
+			}
+		}
+
+		inline void invoke(std::type_info const& tid, Entry const& entry, EventBase const& e, [[maybe_unused]] Probe const& probe)
+		{
+			auto& handler		= *entry.handler;	// moved to m_retired, not destroyed, if it unsubscribes itself
+			auto  receiver		= entry.receiver;
+			auto& receiverType	= handler.receiverType; // the handler may unsubscribe itself
+
+			observer().onHandlerBegin(tid, receiver, receiverType);
+
+#ifdef EVENT_MANAGER_ENABLE_STATS
+			(*handler.calls)++;
+#endif
+
+#ifdef EVENT_MANAGER_INTERNAL_TIMING
+			if (probe.timed())
+				invokeTimed(tid, handler, receiver, e, probe);
+			else
+#endif
+			handler.handle(receiver, e, tid);
+
+			observer().onHandlerEnd(tid, receiver, receiverType);
+		}
+
+#ifdef EVENT_MANAGER_INTERNAL_TIMING
+		inline void invokeTimed([[maybe_unused]] std::type_info const& tid, EventHandler const& handler, void* receiver, EventBase const& e, [[maybe_unused]] Probe const& probe)
+		{
+			// The handler may unsubscribe itself, so copy what is needed afterwards
+			[[maybe_unused]] auto& receiverType = handler.receiverType;
+
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+			auto latency = handler.latency;
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_PERF_COUNTERS
+			auto		perf = handler.perf;
+			PerfValues	before{};
+
+			if (probe.sampled)
+				PerfCounters::get().read(before);
+#endif
+
+			[[maybe_unused]] auto begin = now();
+
+			handler.handle(receiver, e, tid);
+
+			[[maybe_unused]] auto end = now();
+
+#ifdef EVENT_MANAGER_ENABLE_PERF_COUNTERS
+			if (probe.sampled)
+			{
+				PerfValues after{};
+				PerfCounters::get().read(after);
+
+				perf->add(before, after);
+			}
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+			if (probe.sampled)
+				latency->record(end - begin);
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+			if (probe.trace)
+				Tracer::record(SpanKind::Handler, tid, &receiverType, begin, end);
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_WATCHDOG
+			if (probe.slowAfter)
+				Watchdog::get().check(CallKind::Handler, tid, receiver, &receiverType, end - begin, probe.slowAfter);
+#endif
+		}
+#endif
+
+		// Ascending with the phase, then descending with the priority
+		static inline int64_t rank(Phase phase, Priority priority)
+		{
+			return (static_cast<int64_t>(phase) << 32) + INT32_MAX - priority.value;
+		}
+
+		inline void insert(Subscription& subscription, void* receiver, Handler&& handler, SubscribeOptions&& options)
+		{
+#ifdef EVENT_MANAGER_ENABLE_STATS
+			handler->calls = &m_calls[handler->receiverType];
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+			handler->latency = &m_latencies[handler->receiverType];
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_PERF_COUNTERS
+			handler->perf = &m_perf[handler->receiverType];
+#endif
+
+			auto phase	= options.phase;
+			auto key	= rank(phase, options.priority);
+
+			m_subscriptions++;
+
+			// Last of its band, that is before the first entry of the next rank: O(log bands)
+			auto [band, created]	= m_bands.try_emplace(key);
+			auto next				= std::next(band);
+
+			auto position = m_order.insert(next == m_bands.end() ? m_order.end() : next->second.first,
+				{ ++m_serial, receiver, std::move(handler), key, NoSlot, options.group.index, false });
+
+			if (created)
+				band->second.first = position;
+
+			band->second.size++;
+
+			auto index = static_cast<uint8_t>(phase);
+
+			subscription.positions[index]	= position;
+			subscription.phases				|= 1 << index;
+
+			if (!options.constraints.empty())
+				m_constraints[&*position] = std::move(options.constraints);
+
+			m_dirty = true;
+		}
+
+		// A handler may unsubscribe itself, so while executing the entry is only marked Removed
+		inline void retire(Order::iterator position)
+		{
+			m_subscriptions--;
+
+			if (m_executing)  // for nested events
+			{
+				// Keep the handler alive until the dispatch is over
+				m_retired.push_back(std::move(position->handler));
+
+				position->serial	= Removed;
+				m_needsCleanUp		= true;
+				m_dirty				= true;
+			}
+
+			else
+				erase(position);
+		}
+
+		inline Order::iterator find(Handle handle)
+		{
+			if (handle.slot >= m_slots.size())
+				return m_order.end();
+
+			auto position = m_slots[handle.slot];
+
+			// Freed slots point to the end, reused ones to an entry with another serial
+			return position != m_order.end() && position->serial == handle.serial ? position : m_order.end();
+		}
+
+		inline void erase(Order::iterator position)
+		{
+			if (position->slot != NoSlot)
+			{
+				m_slots[position->slot] = m_order.end();
+				m_freeSlots.push_back(position->slot);
+			}
+
+			auto band = m_bands.find(position->rank);
+
+			if (!--band->second.size)
+				m_bands.erase(band);
+
+			else if (band->second.first == position)
+				band->second.first = std::next(position);
+
+			if (!m_constraints.empty())
+				m_constraints.erase(&*position);
+
+			m_order.erase(position);
+			m_dirty = true;
+		}
+
+		// Topological order of the live entries that otherwise keeps the list order (phase, priority, serial).
+		// Each constrained receiver type or receiver gets a gate node in front of its entries and one behind them,
+		// so "before every T" costs one edge per entry of T. O(n + edges), only after subscription changes.
+		inline void sort(std::type_info const& tid, OrderCycleCallback const& onCycle)
+		{
+			constexpr uint32_t None = UINT32_MAX;
+
+			struct Gates
+			{
+				uint32_t front	= None;
+				uint32_t back	= None;
+			};
+
+			m_dirty = false;
+
+			std::vector<Entry*> nodes;
+			for (auto& entry : m_order)
+				if (entry.serial != Removed)
+					nodes.push_back(&entry);
+
+			auto count = static_cast<uint32_t>(nodes.size());
+
+			std::vector<std::pair<uint32_t, uint32_t> >	edges;	// (to, from)
+			uint32_t									size = count;
+
+			auto edge = [&](uint32_t from, uint32_t to)
+			{
+				edges.push_back({ to, from });
+			};
+
+			auto gate = [&](uint32_t& node)
+			{
+				if (node == None)
+					node = size++;
+
+				return node;
+			};
+
+			std::map<std::pair<Phase, std::type_index>, Gates>	typeGates;
+			std::map<std::pair<Phase, void const*>, Gates>		receiverGates;
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				auto constraints = m_constraints.find(nodes[i]);
+				if (constraints == m_constraints.end())
+					continue;
+
+				auto phase = phaseOf(*nodes[i]);
+
+				for (auto& constraint : constraints->second)
+				{
+					auto& gates = constraint.receiver
+						? receiverGates[{ phase, constraint.receiver }]
+						: typeGates[{ phase, *constraint.receiverType }];
+
+					if (constraint.relation == Relation::Before)
+						edge(i, gate(gates.front));
+					else
+						edge(gate(gates.back), i);
+				}
+			}
+
+			auto link = [&](uint32_t i, Gates const& gates)
+			{
+				if (gates.front != None)
+					edge(gates.front, i);
+
+				if (gates.back != None)
+					edge(i, gates.back);
+			};
+
+			for (uint32_t i = 0; i < count; i++)
+			{
+				auto phase = phaseOf(*nodes[i]);
+
+				if (auto gates = typeGates.find({ phase, nodes[i]->handler->receiverType }); gates != typeGates.end())
+					link(i, gates->second);
+
+				if (auto gates = receiverGates.find({ phase, nodes[i]->receiver }); gates != receiverGates.end())
+					link(i, gates->second);
+			}
+
+			// The predecessors of node i are sources[offsets[i]] to sources[offsets[i + 1] - 1]
+			std::vector<uint32_t> offsets(size + 1), sources(edges.size());
+
+			for (auto [to, from] : edges)
+				offsets[to + 1]++;
+
+			for (uint32_t node = 0; node < size; node++)
+				offsets[node + 1] += offsets[node];
+
+			{
+				auto fill = offsets;
+
+				for (auto [to, from] : edges)
+					sources[fill[to]++] = from;
+			}
+
+			// Walk the entries in list order and emit the unemitted predecessors of each one first (iterative DFS),
+			// so constrained entries move forward just enough and everything else keeps the list order
+			enum : uint8_t { New, Active, Emitted };
+
+			struct Frame
+			{
+				uint32_t node;
+				uint32_t next;	// index into sources
+			};
+
+			std::vector<uint8_t>	state(size, New);
+			std::vector<Frame>		stack;
+			bool					reported = false;
+
+			auto sorted = std::make_unique<Sorted>();
+			sorted->reserve(count);
+
+			for (uint32_t root = 0; root < count; root++)
+			{
+				if (state[root] != New)
+					continue;
+
+				state[root] = Active;
+				stack.push_back({ root, offsets[root] });
+
+				while (!stack.empty())
+				{
+					auto [node, next] = stack.back();
+
+					if (next == offsets[node + 1])
+					{
+						state[node] = Emitted;
+						stack.pop_back();
+
+						if (node < count)
+							sorted->push_back(nodes[node]);
+
+						continue;
+					}
+
+					stack.back().next++;
+
+					auto predecessor = sources[next];
+
+					if (state[predecessor] == New)
+					{
+						state[predecessor] = Active;
+						stack.push_back({ predecessor, offsets[predecessor] });
+					}
+
+					// A predecessor on the stack closes a cycle, its edge is dropped
+					else if (state[predecessor] == Active && !reported && onCycle)
+					{
+						reported = true;
+						onCycle(cycle(tid, nodes, stack, predecessor));
+					}
+				}
+			}
+
+			// An outer dispatch may still be walking the previous order
+			if (m_executing && m_sorted)
+			{
+				m_retiredOrders.push_back(std::move(m_sorted));
+				m_needsCleanUp = true;
+			}
+
+			m_sorted = std::move(sorted);
+		}
+
+		// The stack from the top down to the predecessor follows the edges of the cycle
+		template <typename Stack>
+		static inline OrderCycle cycle(std::type_info const& tid, std::vector<Entry*> const& nodes, Stack const& stack, uint32_t predecessor)
+		{
+			OrderCycle result{ tid, phaseOf(*nodes[stack.front().node]), {} };
+
+			for (auto it = stack.rbegin(); it != stack.rend(); ++it)
+			{
+				if (it->node < nodes.size())
+					result.receivers.push_back(&nodes[it->node]->handler->receiverType);
+
+				if (it->node == predecessor)
+					break;
+			}
+
+			return result;
+		}
+
+		inline void cleanUp()
+		{
+			if (!m_needsCleanUp)
+				return;
+
+			m_needsCleanUp = false;
+
+			// The handlers of removed entries are already in m_retired
+			for (auto it = m_order.begin(); it != m_order.end(); )
+			{
+				auto position = it++;
+
+				if (position->serial == Removed)
+					erase(position);
+			}
+
+			m_retiredOrders.clear();
+
+			// Destroyed last, lambda captures may unsubscribe other receivers
+			std::vector<Handler> retired;
+			retired.swap(m_retired);
+		}
+	};
+
+	class UrgentActionList
+	{
+	public:
+		inline void add(Action&& action)
+		{
+			m_actions.push_back({ std::move(action) });
+		}
+
+		// tid is the event whose publish triggered the actions
+		inline void exec(std::type_info const& tid, Probe const& probe)
+		{
+			if (m_actions.empty())
+				return;
+
+			// Actions scheduled meanwhile, or by nested publishes, wait for the next publish
+			ActionList actions;
+			actions.swap(m_actions);
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+			auto begin = probe.trace ? now() : 0;
+#endif
+
+			for (const auto& scheduled : actions)
+				run(scheduled.action, CallKind::UrgentAction, tid, probe);
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+			if (begin)
+				Tracer::record(SpanKind::UrgentActions, tid, nullptr, begin, now());
+#endif
+		}
+
+		inline size_t pending() const
+		{
+			return m_actions.size();
+		}
+
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+		inline std::chrono::nanoseconds oldest(uint64_t time) const
+		{
+			return internal::oldest(m_actions, time);
+		}
+
+		inline void collectStale(uint64_t time, uint64_t maxAge, bool drop, std::vector<StaleAction>& stale, ActionList& dropped)
+		{
+			internal::collectStale(m_actions, CallKind::UrgentAction, typeid(void), time, maxAge, drop, stale, dropped);
+		}
+#endif
+
+	private:
+		ActionList m_actions;
+	};
+
+	class EventActionList
+	{
+	public:
+		inline void add(std::type_info const& tid, Action&& action)
+		{
+			m_actions[tid].push_back({ std::move(action) });
+		}
+
+		inline void exec(std::type_info const& tid, Probe const& probe)
+		{
+			auto entry = m_actions.find(tid);
+			if (entry == m_actions.end())
+				return;
+
+			// Actions scheduled meanwhile, or by nested publishes, wait for the next publish.
+			// The slot is erased so that types which are never scheduled for again do not keep one.
+			ActionList actions = std::move(entry->second);
+			m_actions.erase(entry);
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+			auto begin = probe.trace ? now() : 0;
+#endif
+
+			for (const auto& scheduled : actions)
+				run(scheduled.action, CallKind::EventAction, tid, probe);
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+			if (begin)
+				Tracer::record(SpanKind::EventActions, tid, nullptr, begin, now());
+#endif
+		}
+
+		// Number of actions waiting for the event
+		inline size_t pending(std::type_index tid) const
+		{
+			auto entry = m_actions.find(tid);
+			return entry != m_actions.end() ? entry->second.size() : 0;
+		}
+
+		// Calls fn(type, actions) for every event type with pending actions
+		template <typename Fn>
+		inline void forEach(Fn&& fn) const
+		{
+			for (auto& [type, actions] : m_actions)
+				fn(type, actions);
+		}
+
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+		inline void collectStale(uint64_t time, uint64_t maxAge, bool drop, std::vector<StaleAction>& stale, ActionList& dropped)
+		{
+			for (auto entry = m_actions.begin(); entry != m_actions.end(); )
+			{
+				internal::collectStale(entry->second, CallKind::EventAction, entry->first, time, maxAge, drop, stale, dropped);
+
+				if (entry->second.empty())
+					entry = m_actions.erase(entry);
+				else
+					++entry;
+			}
+		}
+#endif
+
+	private:
+		using EventActions = std::unordered_map<std::type_index, ActionList>;
+
+		EventActions m_actions;
+	};
+
+	// Intermediate graph of EventManager::dumpTopology
+	class Topology
+	{
+	public:
+		struct Event
+		{
+			size_t		id{};
+			std::string	name;
+			uint64_t	publishes{};
+			size_t		pendingActions{};
+		};
+
+		struct Edge
+		{
+			size_t		subscribers{};
+			uint64_t	calls{};
+			uint64_t	time{};		// nanoseconds
+		};
+
+		struct Cause
+		{
+			size_t		from{};
+			size_t		to{};
+			uint64_t	publishes{};
+		};
+
+		std::vector<Cause>	causes;
+		size_t				pendingUrgentActions{};
+
+		inline Event& event(std::type_index type)
+		{
+			auto [entry, added] = m_eventIds.try_emplace(type, m_events.size());
+			if (added)
+				m_events.push_back({ .id = m_events.size(), .name = typeName(type) });
+
+			return m_events[entry->second];
+		}
+
+		inline Edge& edge(std::type_index eventType, std::type_index receiverType)
+		{
+			auto [entry, added] = m_receiverIds.try_emplace(receiverType, m_receivers.size());
+			if (added)
+				m_receivers.push_back(typeName(receiverType));
+
+			return m_edges[{ event(eventType).id, entry->second }];
+		}
+
+		inline std::string dot() const
+		{
+			std::ostringstream out;
+
+			out << "digraph EventManager {\n\trankdir=LR;\n";
+
+			for (auto& e : m_events)
+			{
+				out << "\te" << e.id << " [shape=box, label=" << quote(e.name
+					+ (e.publishes      ? "\n" + std::to_string(e.publishes) + " publishes" : "")
+					+ (e.pendingActions ? "\n" + std::to_string(e.pendingActions) + " pending actions" : "")) << "];\n";
+			}
+
+			for (size_t id = 0; id < m_receivers.size(); id++)
+				out << "\tr" << id << " [shape=ellipse, label=" << quote(m_receivers[id]) << "];\n";
+
+			for (auto& [ids, edge] : m_edges)
+			{
+				out << "\te" << ids.first << " -> r" << ids.second << " [label=" << quote(std::to_string(edge.subscribers) + " subscribers"
+					+ (edge.calls ? "\n" + std::to_string(edge.calls) + " calls" : "")
+					+ (edge.time  ? "\n" + duration(edge.time) : "")) << "];\n";
+			}
+
+			for (auto& cause : causes)
+				out << "\te" << cause.from << " -> e" << cause.to << " [style=dashed, label=" << quote("publishes " + std::to_string(cause.publishes)) << "];\n";
+
+			if (pendingUrgentActions)
+				out << "\turgent [shape=note, label=" << quote(std::to_string(pendingUrgentActions) + " pending urgent actions") << "];\n";
+
+			out << "}\n";
+
+			return out.str();
+		}
+
+		inline std::string json() const
+		{
+			std::ostringstream out;
+
+			out << "{\n\"events\": [";
+
+			for (auto& e : m_events)
+			{
+				out << (e.id ? ",\n\t" : "\n\t") << "{\"id\": " << e.id << ", \"name\": " << quote(e.name)
+					<< ", \"publishes\": " << e.publishes << ", \"pendingActions\": " << e.pendingActions << "}";
+			}
+
+			out << "\n],\n\"receivers\": [";
+
+			for (size_t id = 0; id < m_receivers.size(); id++)
+				out << (id ? ",\n\t" : "\n\t") << "{\"id\": " << id << ", \"name\": " << quote(m_receivers[id]) << "}";
+
+			out << "\n],\n\"subscriptions\": [";
+
+			bool first = true;
+			for (auto& [ids, edge] : m_edges)
+			{
+				out << (first ? "\n\t" : ",\n\t") << "{\"event\": " << ids.first << ", \"receiver\": " << ids.second
+					<< ", \"subscribers\": " << edge.subscribers << ", \"calls\": " << edge.calls << ", \"timeNs\": " << edge.time << "}";
+
+				first = false;
+			}
+
+			out << "\n],\n\"causality\": [";
+
+			first = true;
+			for (auto& cause : causes)
+			{
+				out << (first ? "\n\t" : ",\n\t") << "{\"from\": " << cause.from << ", \"to\": " << cause.to << ", \"publishes\": " << cause.publishes << "}";
+
+				first = false;
+			}
+
+			out << "\n],\n\"pendingUrgentActions\": " << pendingUrgentActions << "\n}\n";
+
+			return out.str();
+		}
+
+	private:
+		std::vector<Event>								m_events;
+		std::vector<std::string>						m_receivers;
+		std::unordered_map<std::type_index, size_t>		m_eventIds;
+		std::unordered_map<std::type_index, size_t>		m_receiverIds;
+		std::map<std::pair<size_t, size_t>, Edge>		m_edges;	// (event id, receiver id)
+
+		static inline std::string duration(uint64_t ns)
+		{
+			char text[32];
+
+			if (ns < 1'000)
+				std::snprintf(text, sizeof(text), "%llu ns", static_cast<unsigned long long>(ns));
+			else if (ns < 1'000'000)
+				std::snprintf(text, sizeof(text), "%.2f us", static_cast<double>(ns) / 1e3);
+			else
+				std::snprintf(text, sizeof(text), "%.2f ms", static_cast<double>(ns) / 1e6);
+
+			return text;
+		}
+
+		static inline std::string quote(std::string const& text)
+		{
+			std::string result = "\"";
+
+			for (char c : text)
+			{
+				if (c == '"' || c == '\\')
+					result += '\\';
+
+				if (c == '\n')
+					result += "\\n";
+				else
+					result += c;
+			}
+
+			return result + '"';
+		}
+	};
+		
+} // namespace internal
+
+// Owns one subscription made with EventManager::connect and removes it in O(1) when destroyed.
+// Must not outlive the EventManager; receivers still unsubscribe everything when destroyed.
+class Connection
+{
+public:
+	Connection() = default;
+
+	Connection(Connection&& other) noexcept :
+		m_list(std::exchange(other.m_list, nullptr)), m_event(other.m_event), m_handle(other.m_handle) { }
+
+	Connection& operator = (Connection&& other) noexcept
+	{
+		if (this != &other)
+		{
+			disconnect();
+
+			m_list		= std::exchange(other.m_list, nullptr);
+			m_event		= other.m_event;
+			m_handle	= other.m_handle;
+		}
+
+		return *this;
+	}
+
+	Connection(Connection const&)              = delete;
+	Connection& operator = (Connection const&) = delete;
+
+	~Connection()
+	{
+		disconnect();
+	}
+
+	// Removes the subscription now
+	inline void disconnect();
+
+	// Keeps the subscription, which then lasts until its receiver unsubscribes
+	inline void release()
+	{
+		m_list = nullptr;
+	}
+
+	// A blocked subscription keeps its place and is skipped by publish and query
+	inline void block(bool blocked = true)
+	{
+		if (m_list)
+			m_list->block(m_handle, blocked);
+	}
+
+	inline void unblock()
+	{
+		block(false);
+	}
+
+	inline bool blocked() const
+	{
+		return m_list && m_list->blocked(m_handle);
+	}
+
+	// False once released, disconnected, or unsubscribed by other means
+	inline bool connected() const
+	{
+		return m_list && m_list->contains(m_handle);
+	}
+
+private:
+	friend class EventManager;
+
+	using HandlerList = internal::EventHandlerList;
+
+	HandlerList*			m_list{};
+	std::type_info const*	m_event{};
+	HandlerList::Handle		m_handle;
+
+	Connection(HandlerList& list, std::type_info const& event, HandlerList::Handle handle) :
+		m_list(&list), m_event(&event), m_handle(handle) { }
+};
+
+class EventManager
+{
+public:
+	inline static EventManager& get()
+	{
+		static EventManager instance;
+		return instance;
+	}
+
+	EventManager(const EventManager&)              = delete;
+	EventManager& operator = (const EventManager&) = delete;
+
+	// Publish an event to all subscribers
+	template <DerivedFromEventBase EventType>
+	constexpr void publish(EventType&& e)
+	{
+		auto& tid = typeid(EventType);
+
+		if (!enter(tid))
+			return;
+
+		internal::observer().onPublishBegin(tid);
+
+		internal::Probe const probe(tid, m_chain.size() == 1);
+
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+		if (m_maxActionAge && m_chain.size() == 1)
+		{
+			auto time = internal::now();
+
+			if (time >= m_nextSweep)
+			{
+				m_nextSweep = time + m_maxActionAge / 2;
+				sweep(time);
+			}
+		}
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+		auto begin = probe.trace ? internal::now() : 0;
+#endif
+
+		m_urgentActions.exec(tid, probe);
+
+#ifdef EVENT_MANAGER_ENABLE_STATS
+		// Every published type gets a slot so that publishes without subscribers are counted too
+		m_subscriptions[tid].dispatch(tid, e, probe, m_activeGroups, m_orderCycleCallback);
+#else
+		{
+			auto entry = m_subscriptions.find(tid);
+			if (entry != m_subscriptions.end())
+				entry->second.dispatch(tid, e, probe, m_activeGroups, m_orderCycleCallback);
+		}
+#endif
+
+		if (m_anyHandlers.size())
+			dispatchAny(tid, e, probe);
+
+		m_eventActions.exec(tid, probe);
+
+#ifdef EVENT_MANAGER_ENABLE_TRACING
+		if (begin)
+			Tracer::record(SpanKind::Publish, tid, nullptr, begin, internal::now());
+#endif
+
+		internal::observer().onPublishEnd(tid);
+
+		m_chain.pop_back();
+	}
+
+	// Nesting is unlimited by default
+	static constexpr uint32_t NoPublishDepthLimit = UINT32_MAX;
+
+	// Nested publishes deeper than this are dropped and reported as CascadeIssue::DepthLimit (opt-in)
+	inline void setMaxPublishDepth(uint32_t depth)
+	{
+		m_maxDepth = std::max<uint32_t>(depth, 1);
+	}
+
+	// Called on cycles (E_A -> E_B -> E_A) and dropped publishes; cycles are only looked for while it is set
+	inline void setCascadeCallback(CascadeCallback&& callback)
+	{
+		m_cascadeCallback = std::move(callback);
+	}
+
+	// Number of publishes in progress, 0 outside of any publish
+	inline size_t publishDepth() const
+	{
+		return m_chain.size();
+	}
+
+	// Event types being published, outermost first
+	inline std::span<std::type_info const* const> publishChain() const
+	{
+		return m_chain;
+	}
+
+	template <DerivedFromEventBase EventType>
+	constexpr void schedule(Action&& action)
+	{
+#ifdef EVENT_MANAGER_ENABLE_STATS
+		m_subscriptions.try_emplace(typeid(EventType)); // make the type visible in stats()
+#endif
+
+		m_eventActions.add(typeid(EventType), std::move(action));
+
+		internal::observer().onSchedule(CallKind::EventAction, typeid(EventType));
+	}
+
+	inline void schedule(Action&& urgentAction)
+	{
+		m_urgentActions.add(std::move(urgentAction));
+
+		internal::observer().onSchedule(CallKind::UrgentAction, typeid(void));
+	}
+
+	// Subscribe to event; the options are an el::Phase, an el::Priority, an el::Group and el::before / el::after constraints.
+	// A method returning a value also answers query<EventType, Result>; publish() discards its result.
+	template <typename Receiver, DerivedFromEventBase EventType, typename Result, SubscribeOption... Options>
+	constexpr void subscribe(EventReceiver& receiver, Result(Receiver::* method)(EventType const&), Options... options)
+	{
+		auto receiver_ptr = &receiver;
+
+		auto settings = makeOptions(options...);
+
+		if (m_subscriptions[typeid(EventType)].add(receiver_ptr, method, std::move(settings)))
+			added(typeid(EventType), receiver_ptr);
+	}
+
+	// Subscribe to event; the options are an el::Phase, an el::Priority, an el::Group and el::before / el::after constraints
+	template <DerivedFromEventBase EventType, SubscribeOption... Options>
+	constexpr void subscribe(EventReceiver& receiver, std::function<void(EventType const&)>&& action, Options... options)
+	{
+		auto receiver_ptr = &receiver;
+
+		auto settings = makeOptions(options...);
+
+		if (m_subscriptions[typeid(EventType)].add<EventType>(receiver_ptr, typeid(receiver), std::move(action), std::move(settings)))
+			added(typeid(EventType), receiver_ptr);
+	}
+
+	// Subscribe with a lambda that answers query<EventType, Result>, e.g. subscribe<E_Damage, int>(receiver, ...)
+	template <DerivedFromEventBase EventType, typename Result, SubscribeOption... Options>
+		requires (!std::is_void_v<Result>)
+	constexpr void subscribe(EventReceiver& receiver, std::function<Result(EventType const&)>&& action, Options... options)
+	{
+		auto receiver_ptr = &receiver;
+
+		auto settings = makeOptions(options...);
+
+		if (m_subscriptions[typeid(EventType)].add<EventType, Result>(receiver_ptr, typeid(receiver), std::move(action), std::move(settings)))
+			added(typeid(EventType), receiver_ptr);
+	}
+
+	// Like subscribe, but the subscription is owned by the returned Connection. Empty if the receiver
+	// is already subscribed to EventType in that phase.
+	template <typename Receiver, DerivedFromEventBase EventType, typename Result, SubscribeOption... Options>
+	[[nodiscard]] inline Connection connect(EventReceiver& receiver, Result(Receiver::* method)(EventType const&), Options... options)
+	{
+		auto receiver_ptr = &receiver;
+
+		auto settings = makeOptions(options...);
+
+		auto phase	= settings.phase;
+		auto& list	= m_subscriptions[typeid(EventType)];
+
+		if (!list.add(receiver_ptr, method, std::move(settings)))
+			return {};
+
+		added(typeid(EventType), receiver_ptr);
+
+		return { list, typeid(EventType), list.track(receiver_ptr, phase) };
+	}
+
+	template <DerivedFromEventBase EventType, SubscribeOption... Options>
+	[[nodiscard]] inline Connection connect(EventReceiver& receiver, std::function<void(EventType const&)>&& action, Options... options)
+	{
+		auto receiver_ptr = &receiver;
+
+		auto settings = makeOptions(options...);
+
+		auto phase	= settings.phase;
+		auto& list	= m_subscriptions[typeid(EventType)];
+
+		if (!list.add<EventType>(receiver_ptr, typeid(receiver), std::move(action), std::move(settings)))
+			return {};
+
+		added(typeid(EventType), receiver_ptr);
+
+		return { list, typeid(EventType), list.track(receiver_ptr, phase) };
+	}
+
+	// Calls the subscribers of EventType that return Result, in dispatch order, and passes each result to
+	// collector (el::Sum, el::Min, el::FirstNonNull, el::Append or any callable taking Result&&).
+	// Stops when the collector returns false or a subscriber sets handled. Returns the number of results.
+	// Only the subscribers run: no actions, no wildcard subscribers. The bus allocates nothing, except that
+	// like publish the first query after the subscriptions of an event type with constraints changed sorts it.
+	template <DerivedFromEventBase EventType, typename Result, typename Collector>
+	inline size_t query(EventType const& e, Collector& collector)
+	{
+		auto entry = m_subscriptions.find(typeid(EventType));
+		if (entry == m_subscriptions.end())
+			return 0;
+
+		internal::Fold<Result> const fold{ &collector,
+			[](void* to, Result&& value)
+			{
+				auto& collect = *static_cast<Collector*>(to);
+
+				if constexpr (std::is_void_v<std::invoke_result_t<Collector&, Result&&> >)
+				{
+					collect(std::move(value));
+					return true;
+				}
+				else
+					return static_cast<bool>(collect(std::move(value)));
+			}
+		};
+
+		return entry->second.query(typeid(EventType), e, fold, m_activeGroups, m_orderCycleCallback);
+	}
+
+	// Subscribe to every event type. Wildcard subscribers are notified after the subscribers of the event type,
+	// whether they set handled or not; handled set by a wildcard subscriber only stops the other wildcard subscribers.
+	template <SubscribeOption... Options>
+	inline void subscribeAny(EventReceiver& receiver, AnyEventAction&& action, Options... options)
+	{
+		auto receiver_ptr = &receiver;
+
+		auto settings = makeOptions(options...);
 
-	template <DerivedFromEventBase E>
-	class LambdaEventHandler : public EventHandler
+		if (m_anyHandlers.add(receiver_ptr, typeid(receiver), std::move(action), std::move(settings)))
+			added(typeid(void), receiver_ptr);
+	}
+
+	// Unsubscribe from every event type, subscriptions to specific types stay
+	inline void unsubscribeAny(EventReceiver& receiver)
 	{
-	public:
-		using Lambda = std::function<void(E const&)>;
+		auto receiver_ptr = &receiver;
 
-		LambdaEventHandler(Lambda&& lambda) : 
-			m_lambda(std::move(lambda)) { }
+		auto sc_entry = m_subsCount.find(receiver_ptr);
+		if (sc_entry == m_subsCount.end())
+			return;
 
-		void handle(void*, EventBase const& e) const final
+		if (auto removed = m_anyHandlers.remove(receiver_ptr))
 		{
-			m_lambda(static_cast<E const&>(e));
+			sc_entry->second -= static_cast<uint32_t>(removed);
+
+			if (!sc_entry->second)
+				m_subsCount.erase(sc_entry);
+
+			internal::observer().onUnsubscribe(typeid(void), receiver_ptr);
 		}
+	}
 
-	private:
-		Lambda m_lambda{};
-	};
+	// Called when the before / after constraints of an event type form a cycle, once per change of its subscriptions
+	inline void setOrderCycleCallback(OrderCycleCallback&& callback)
+	{
+		m_orderCycleCallback = std::move(callback);
+	}
 
-	class EventHandlerList
+	// Paused subscriptions keep their place and are skipped until resumed, in O(1) for any number of receivers
+	inline void pauseGroup(Group group)
 	{
-	public:
-		using Handler = std::unique_ptr<EventHandler>;
+		m_activeGroups &= ~internal::groupBit(group);
+	}
 
-		EventHandlerList() = default;
+	inline void resumeGroup(Group group)
+	{
+		m_activeGroups |= internal::groupBit(group);
+	}
 
-		inline void dispatch(EventBase const& e)
-		{
-			m_executing = true;     // for nested events
+	inline bool isGroupActive(Group group) const
+	{
+		return m_activeGroups & internal::groupBit(group);
+	}
 
-			for (auto handler : m_order)
-			{
-				if (!handler)
-					continue;
+	// Bit per group, all set by default
+	inline void setActiveGroups(uint64_t mask)
+	{
+		m_activeGroups = mask;
+	}
 
-				m_handlers[handler]->handle(handler, e);
+	inline uint64_t activeGroups() const
+	{
+		return m_activeGroups;
+	}
 
-				if (e.handled)
-					break;
-			}
+	// Unsubscribe from a specific event, in every phase
+	template <DerivedFromEventBase EventType>
+	constexpr void unsubscribe(EventReceiver& receiver)
+	{
+		auto receiver_ptr = &receiver;
 
-			m_executing = false;   // for nested events
+		auto sc_entry = m_subsCount.find(receiver_ptr);
+		if (sc_entry == m_subsCount.end())
+			return;
 
-			cleanUp();             // for nested events
-		}
+		auto _s_entry = m_subscriptions.find(typeid(EventType));
+		if (_s_entry == m_subscriptions.end())
+			return;
 
-		template <DerivedFromEventReceiver R, DerivedFromEventBase E>
-		constexpr void add(R* receiver, void(R::* method)(E const&))
+		if (auto removed = _s_entry->second.remove(receiver_ptr))
 		{
-			auto entry = m_handlers.find(receiver);
-			if (entry == m_handlers.end())
-			{
-				m_handlers[receiver] = std::make_unique<MethodEventHandler<R, E> >(method);
-				m_order.push_back(receiver);
-			}
+			sc_entry->second -= static_cast<uint32_t>(removed);
+
+			if (!sc_entry->second)
+				m_subsCount.erase(sc_entry);
+
+			internal::observer().onUnsubscribe(typeid(EventType), receiver_ptr);
 		}
+	}
+
+	// Unsubscribe from all events
+	inline void unsubscribeAll(EventReceiver& receiver)
+	{
+		auto receiver_ptr = &receiver;
 
-		template <DerivedFromEventBase E>
-		constexpr void add(void* receiver, std::function<void(E const&)>&& lambda)
+		// Otherwise el::before(receiver) and el::after(receiver) would apply to the next receiver at this address
+		if (!m_constraintTargets.empty() && m_constraintTargets.erase(receiver_ptr))
 		{
-			auto entry = m_handlers.find(receiver);
-			if (entry == m_handlers.end())
-			{
-				m_handlers[receiver] = std::make_unique<LambdaEventHandler<E> >(std::move(lambda));
-				m_order.push_back(receiver);
-			}
+			for (auto& [type, handlers] : m_subscriptions)
+				handlers.forget(receiver_ptr);
+
+			m_anyHandlers.forget(receiver_ptr);
 		}
 
-		inline void remove(void* receiver)
-		{
-			auto entry = m_handlers.find(receiver);
-			if (entry == m_handlers.end())
-				return;
+		auto sc_entry = m_subsCount.find(receiver_ptr);
+		if (sc_entry == m_subsCount.end() || !sc_entry->second)
+			return;
 
-			m_handlers.erase(entry);
+		for (auto& [type, handlers] : m_subscriptions)
+			if (handlers.remove(receiver_ptr))
+				internal::observer().onUnsubscribe(type, receiver_ptr);
 
-			if (m_executing)  // for nested events
-			{
-				m_needsCleanUp = true;
+		if (m_anyHandlers.remove(receiver_ptr))
+			internal::observer().onUnsubscribe(typeid(void), receiver_ptr);
 
-				auto it = std::find(m_order.begin(), m_order.end(), receiver);
-				*it = nullptr;
-			}
+		m_subsCount.erase(sc_entry);
+	}
 
-			else
-				m_order.remove(receiver);
-		}
+	// Graph of event types, subscribed receiver types and pending actions. Edges carry subscriber counts,
+	// plus invocation counts and nested-publish causality with stats and total handler time with histograms.
+	inline std::string dumpTopology(TopologyFormat format = TopologyFormat::Dot) const
+	{
+		internal::Topology topology;
 
-		inline void clear()
+		for (auto& [type, handlers] : m_subscriptions)
 		{
-			m_handlers .clear();
-			m_order    .clear();
-		}
+			[[maybe_unused]] auto& node = topology.event(type); // listed even without subscribers
 
-	private:
-		std::unordered_map<void*, Handler>	m_handlers;
-		std::list<void*>					m_order;
-
-		bool m_executing{};
-		bool m_needsCleanUp{};
+#ifdef EVENT_MANAGER_ENABLE_STATS
+			node.publishes = handlers.stats().publishes;
 
-		inline void cleanUp()
-		{
-			if (!m_needsCleanUp)
-				return;
+			for (auto& [receiverType, calls] : handlers.calls())
+				topology.edge(type, receiverType).calls = calls;
+#endif
 
-			m_needsCleanUp = false;
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+			for (auto& [receiverType, histogram] : handlers.latencies())
+				topology.edge(type, receiverType).time = histogram.sum();
+#endif
 
-			m_order.remove_if(
-				[](auto handler)
+			handlers.forEach(
+				[&](void*, internal::EventHandler const& handler)
 				{
-					return !handler;
+					topology.edge(type, handler.receiverType).subscribers++;
 				}
 			);
 		}
-	};
 
-	class UrgentActionList
-	{
-	public:
-		inline void add(Action&& action)
-		{
-			if (m_executing)
-				m_buffer.push_back(std::move(action));
+		m_eventActions.forEach(
+			[&](std::type_index type, auto const& actions)
+			{
+				topology.event(type).pendingActions = actions.size();
+			}
+		);
 
-			else
-				m_actions.push_back(std::move(action));
-		}
+#ifdef EVENT_MANAGER_ENABLE_STATS
+		for (auto& [types, count] : m_causality)
+			topology.causes.push_back({ topology.event(types.first).id, topology.event(types.second).id, count });
+#endif
 
-		inline void exec()
-		{
-			m_executing = true;
+		topology.pendingUrgentActions = m_urgentActions.pending();
 
-			m_actions.splice(m_actions.end(), std::move(m_buffer));
-			m_buffer.clear();
+		return format == TopologyFormat::Json ? topology.json() : topology.dot();
+	}
 
-			if (!m_actions.empty())
-			{
-				for (const auto& action : m_actions)
-					action();
+	// The observer instance selected with EVENT_MANAGER_OBSERVER
+	inline Observer& observer()
+	{
+		return internal::observer();
+	}
 
-				m_actions.clear();
-			}
+#ifdef EVENT_MANAGER_ENABLE_STATS
+	// Number of publishes by nesting depth, index 1 counts top-level publishes
+	inline std::vector<uint64_t> const& depthHistogram() const
+	{
+		return m_depthHistogram;
+	}
+
+	// Per-event-type counters for every type that was published, subscribed to or scheduled for
+	inline std::vector<EventStats> stats() const
+	{
+		std::vector<EventStats> result;
+		result.reserve(m_subscriptions.size());
 
-			m_executing = false;
+		for (auto& [type, handlers] : m_subscriptions)
+		{
+			auto& counters = handlers.stats();
+
+			result.push_back({
+				.type			= type,
+				.publishes		= counters.publishes,
+				.invocations	= counters.invocations,
+				.handledEarly	= counters.handledEarly,
+				.subscribers	= handlers.subscriptions(),
+				.pendingActions	= m_eventActions.pending(type)
+			});
 		}
 
-	private:
-		using ActionList = std::list<Action>;
+		return result;
+	}
+#endif
 
-		bool		m_executing{};
-		ActionList	m_actions;
-		ActionList	m_buffer;
-	};
+	// Urgent actions waiting for the next publish
+	inline size_t pendingUrgentActions() const
+	{
+		return m_urgentActions.pending();
+	}
 
-	class EventActionList
+	// Event actions waiting for the next publish of the event type
+	template <DerivedFromEventBase EventType>
+	inline size_t pendingEventActions() const
 	{
-	public:
-		inline void add(type_info const& tid, Action&& action)
-		{
-			if (m_executing)
-				m_buffer[&tid].push_back(std::move(action));
+		return m_eventActions.pending(typeid(EventType));
+	}
 
-			else
-				m_actions[&tid].push_back(std::move(action));
-		}
+	// Pending urgent actions (if any) followed by the pending event actions of every event type
+	inline std::vector<PendingActions> pendingActions() const
+	{
+		std::vector<PendingActions> result;
 
-		inline void exec(type_info const& tid)
-		{
-			m_executing = true;
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+		auto time = internal::now();
 
-			if (!m_buffer.empty())
+		if (auto count = m_urgentActions.pending())
+			result.push_back({ CallKind::UrgentAction, typeid(void), count, m_urgentActions.oldest(time) });
+
+		m_eventActions.forEach(
+			[&](std::type_index type, auto const& actions)
 			{
-				m_actions.merge(std::move(m_buffer));
-				m_buffer.clear();
+				result.push_back({ CallKind::EventAction, type, actions.size(), internal::oldest(actions, time) });
 			}
+		);
+#else
+		if (auto count = m_urgentActions.pending())
+			result.push_back({ CallKind::UrgentAction, typeid(void), count });
 
-			auto entry = m_actions.find(&tid);
-			if (entry != m_actions.end())
+		m_eventActions.forEach(
+			[&](std::type_index type, auto const& actions)
 			{
-				auto& actions = entry->second;
-				if (!actions.empty())
-				{
-					for (const auto& action : actions)
-						action();
-
-					actions.clear();
-				}
+				result.push_back({ CallKind::EventAction, type, actions.size() });
 			}
+		);
+#endif
 
-			m_executing = false;
-		}
-
-	private:
-		using ActionList	= std::list<Action>;
-		using EventActions	= std::unordered_map<type_info const*, ActionList>;
-
-		bool			m_executing{};
-		EventActions	m_actions;
-		EventActions	m_buffer;
-	};
-		
-} // namespace internal
+		return result;
+	}
 
-class EventManager
-{
-public:
-	inline static EventManager& get()
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+	// Report (and with StaleActionPolicy::Drop, destroy) actions pending for longer than maxAge.
+	// Checked at most every maxAge / 2 on top-level publishes, or on demand with collectStaleActions(); zero disables it.
+	inline void setActionMaxAge(std::chrono::nanoseconds maxAge, StaleActionPolicy policy, StaleActionCallback&& callback = {})
 	{
-		static EventManager instance;
-		return instance;
+		m_maxActionAge		= static_cast<uint64_t>(maxAge.count());
+		m_stalePolicy		= policy;
+		m_staleCallback		= std::move(callback);
+		m_nextSweep			= 0;
 	}
 
-	EventManager(const EventManager&)              = delete;
-	EventManager& operator = (const EventManager&) = delete;
-
-	// Publish an event to all subscribers
-	template <DerivedFromEventBase EventType>
-	constexpr void publish(EventType&& e)
+	// Apply the max-age policy now, returns the number of stale actions found
+	inline size_t collectStaleActions()
 	{
-		auto& tid = typeid(EventType);
-
-		m_urgentActions.exec();
+		return m_maxActionAge ? sweep(internal::now()) : 0;
+	}
+#endif
 
-		{
-			auto entry = m_subscriptions.find(tid);
-			if (entry != m_subscriptions.end())
-				entry->second.dispatch(e);
-		}
+#ifdef EVENT_MANAGER_ENABLE_WATCHDOG
+	// Report every handler or action that runs for at least the threshold; zero disables the global threshold
+	inline void setWatchdog(std::chrono::nanoseconds threshold, SlowCallCallback&& callback)
+	{
+		auto& watchdog = internal::Watchdog::get();
 
-		m_eventActions.exec(tid);
+		watchdog.setGlobal(static_cast<uint64_t>(threshold.count()));
+		watchdog.setCallback(std::move(callback));
 	}
 
+	// Override the global threshold for one event type; zero disables the watchdog for it
 	template <DerivedFromEventBase EventType>
-	constexpr void schedule(Action&& action)
+	inline void setWatchdog(std::chrono::nanoseconds threshold)
 	{
-		m_eventActions.add(typeid(EventType), std::move(action));
+		internal::Watchdog::get().setFor(typeid(EventType), static_cast<uint64_t>(threshold.count()));
 	}
 
-	inline void schedule(Action&& urgentAction)
+	// Make the event type use the global threshold again
+	template <DerivedFromEventBase EventType>
+	inline void resetWatchdog()
 	{
-		m_urgentActions.add(std::move(urgentAction));
+		internal::Watchdog::get().resetFor(typeid(EventType));
 	}
+#endif
 
-	// Subscribe to event
-	template <typename Receiver, DerivedFromEventBase EventType>
-	constexpr void subscribe(EventReceiver& receiver, void(Receiver::* method)(EventType const&))
+#ifdef EVENT_MANAGER_INTERNAL_SAMPLING
+	// Record handler timings and trace spans for one top-level publish out of every n (and everything nested in it).
+	// Unsampled publishes only pay for a counter decrement; counters in stats() stay exact.
+	inline void setSampling(uint32_t everyN)
 	{
-		auto receiver_ptr = &receiver;
+		internal::Sampler::get().setEvery(everyN);
+	}
 
-		m_subscriptions[typeid(EventType)].add(static_cast<Receiver*>(receiver_ptr), method);
-		(m_subsCount[receiver_ptr])++;
+	// Record at most one top-level publish per interval, which costs a clock read per top-level publish; 0 turns it off
+	inline void setSampling(std::chrono::nanoseconds interval)
+	{
+		internal::Sampler::get().setInterval(static_cast<uint64_t>(interval.count()));
 	}
+#endif
 
-	// Subscribe to event
-	template <DerivedFromEventBase EventType>
-	constexpr void subscribe(EventReceiver& receiver, std::function<void(EventType const&)>&& action)
+#ifdef EVENT_MANAGER_ENABLE_HISTOGRAMS
+	// Latency histograms of every (event type, receiver type) pair that has been subscribed
+	inline std::vector<HandlerLatency> latencies() const
 	{
-		auto receiver_ptr = &receiver;
+		std::vector<HandlerLatency> result;
+
+		for (auto& [event, handlers] : m_subscriptions)
+			for (auto& [receiver, histogram] : handlers.latencies())
+				result.push_back({ event, receiver, histogram });
 
-		m_subscriptions[typeid(EventType)].add<EventType>(receiver_ptr, std::move(action));
-		(m_subsCount[receiver_ptr])++;
+		return result;
 	}
 
-	// Unsubscribe from a specific event
-	template <DerivedFromEventBase EventType>
-	constexpr void unsubscribe(EventReceiver& receiver)
+	// Latency histogram of a single (event type, receiver type) pair, nullptr if it was never subscribed
+	template <typename Receiver, DerivedFromEventBase EventType>
+	inline Histogram const* latency() const
 	{
-		auto receiver_ptr = &receiver;
+		auto entry = m_subscriptions.find(typeid(EventType));
+		if (entry == m_subscriptions.end())
+			return nullptr;
 
-		auto sc_entry = m_subsCount.find(receiver_ptr);
-		if (sc_entry == m_subsCount.end())
-			return;
+		auto& histograms = entry->second.latencies();
 
-		auto _s_entry = m_subscriptions.find(typeid(EventType));
-		if (_s_entry != m_subscriptions.end())
-		{
-			_s_entry->second.remove(receiver_ptr);
-			sc_entry->second--;
+		auto h_entry = histograms.find(typeid(Receiver));
+		return h_entry != histograms.end() ? &h_entry->second : nullptr;
+	}
 
-			if (!sc_entry->second)
-				m_subsCount.erase(sc_entry);
-		}
+	inline void resetLatencies()
+	{
+		for (auto& [_, handlers] : m_subscriptions)
+			handlers.resetLatencies();
 	}
+#endif
 
-	// Unsubscribe from all events
-	inline void unsubscribeAll(EventReceiver& receiver)
+#ifdef EVENT_MANAGER_ENABLE_PERF_COUNTERS
+	// perf_event counter totals of every (event type, receiver type) pair; see el::PerfCounters::get()
+	// for which counters are available on the publishing thread
+	inline std::vector<HandlerPerf> perfCounters() const
 	{
-		auto receiver_ptr = &receiver;
+		std::vector<HandlerPerf> result;
 
-		auto sc_entry = m_subsCount.find(receiver_ptr);
-		if (sc_entry == m_subsCount.end() || !sc_entry->second)
-			return;
+		for (auto& [event, handlers] : m_subscriptions)
+			for (auto& [receiver, totals] : handlers.perfCounters())
+				result.push_back({ event, receiver, totals });
 
-		for (auto& [_, handlers] : m_subscriptions)
-			handlers.remove(receiver_ptr);
+		return result;
+	}
 
-		m_subsCount.erase(sc_entry);
+	inline void resetPerfCounters()
+	{
+		for (auto& [_, handlers] : m_subscriptions)
+			handlers.resetPerfCounters();
 	}
+#endif
 
 private:
 	using HandlerList		= internal::EventHandlerList;
@@ -403,13 +2624,148 @@ private:
 	using UrgentActionList	= internal::UrgentActionList;
 
 	SubscriptionMap		m_subscriptions;
+	HandlerList			m_anyHandlers;	// wildcard subscribers
 	EventActionList		m_eventActions;
 	UrgentActionList	m_urgentActions;
 
+	std::unordered_set<void const*>		m_constraintTargets;	// receivers named by el::before / el::after
 	std::unordered_map<void*, uint32_t>	m_subsCount;
 
-	EventManager()  = default;
+	std::vector<std::type_info const*>	m_chain;	// event types being published, outermost first
+	uint32_t							m_maxDepth = NoPublishDepthLimit;
+	CascadeCallback						m_cascadeCallback;
+	OrderCycleCallback					m_orderCycleCallback;
+	uint64_t							m_activeGroups = ~uint64_t(0);	// bit per el::Group
+
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+	uint64_t			m_maxActionAge{};	// nanoseconds, 0 when off
+	uint64_t			m_nextSweep{};
+	StaleActionPolicy	m_stalePolicy{};
+	StaleActionCallback	m_staleCallback;
+#endif
+
+#ifdef EVENT_MANAGER_ENABLE_STATS
+	using Causality = std::map<std::pair<std::type_index, std::type_index>, uint64_t>;
+
+	std::vector<uint64_t>	m_depthHistogram;
+	Causality				m_causality;	// (publishing event, nested event) -> publishes
+#endif
+
+	EventManager()
+	{
+		m_chain.reserve(64);	// grows past it for deeper cascades
+	}
+
 	~EventManager() = default;
+
+#ifdef EVENT_MANAGER_ENABLE_ACTION_AGES
+	inline size_t sweep(uint64_t time)
+	{
+		std::vector<StaleAction>	stale;
+		internal::ActionList		dropped;
+
+		bool drop = m_stalePolicy == StaleActionPolicy::Drop;
+
+		m_urgentActions.collectStale(time, m_maxActionAge, drop, stale, dropped);
+		m_eventActions.collectStale(time, m_maxActionAge, drop, stale, dropped);
+
+		// The lists are consistent again, the callback and the destructors of captures may schedule
+		dropped.clear();
+
+		if (m_staleCallback)
+			for (auto& action : stale)
+				m_staleCallback(action);
+
+		return stale.size();
+	}
+#endif
+
+	template <SubscribeOption... Options>
+	inline internal::SubscribeOptions makeOptions(Options... options)
+	{
+		internal::SubscribeOptions settings;
+		(settings.set(options), ...);
+
+		for (auto& constraint : settings.constraints)
+			if (constraint.receiver)
+				m_constraintTargets.insert(constraint.receiver);
+
+		return settings;
+	}
+
+	friend class Connection;
+
+	inline void disconnect(internal::EventHandlerList& list, std::type_info const& event, internal::EventHandlerList::Handle handle)
+	{
+		auto receiver_ptr = list.remove(handle);
+		if (!receiver_ptr)
+			return;
+
+		// Exact, so that a receiver left without subscriptions skips the unsubscribeAll loop
+		auto sc_entry = m_subsCount.find(receiver_ptr);
+
+		if (sc_entry != m_subsCount.end() && !--sc_entry->second)
+			m_subsCount.erase(sc_entry);
+
+		internal::observer().onUnsubscribe(event, receiver_ptr);
+	}
+
+	inline void dispatchAny(std::type_info const& tid, EventBase const& e, internal::Probe const& probe)
+	{
+		// Wildcard subscribers see every event, whether a subscriber of its type handled it or not
+		bool handled = std::exchange(e.handled, false);
+
+		m_anyHandlers.dispatch(tid, e, probe, m_activeGroups, m_orderCycleCallback);
+
+		e.handled = handled;
+	}
+
+	// Push the event type onto the publish chain, false if the publish has to be dropped
+	inline bool enter(std::type_info const& tid)
+	{
+		bool cycle = false;
+
+		if (m_cascadeCallback)
+		{
+			// Report only the first re-entry of a type, not every level of a runaway recursion
+			auto count = std::count(m_chain.begin(), m_chain.end(), &tid);
+			if (count == 1)
+				cycle = true;
+		}
+
+		m_chain.push_back(&tid);
+
+		if (m_chain.size() > m_maxDepth)
+		{
+			if (m_cascadeCallback)
+				m_cascadeCallback({ CascadeIssue::DepthLimit, m_chain });
+
+			m_chain.pop_back();
+			return false;
+		}
+
+		if (cycle)
+			m_cascadeCallback({ CascadeIssue::Cycle, m_chain });
+
+#ifdef EVENT_MANAGER_ENABLE_STATS
+		if (m_chain.size() > 1)
+			m_causality[{ *m_chain[m_chain.size() - 2], tid }]++;
+
+		if (m_depthHistogram.size() <= m_chain.size())
+			m_depthHistogram.resize(m_chain.size() + 1);
+
+		m_depthHistogram[m_chain.size()]++;
+#endif
+
+		return true;
+	}
+
+	inline void added(std::type_info const& tid, EventReceiver* receiver)
+	{
+		(m_subsCount[receiver])++;
+
+		internal::observer().onSubscribe(tid, receiver);
+	}
 };
 
 
@@ -428,4 +2784,10 @@ protected:
 		EM(EventManager::get()) { }
 };
 
-} // namespace el
\ No newline at end of file
+inline void Connection::disconnect()
+{
+	if (m_list)
+		EventManager::get().disconnect(*std::exchange(m_list, nullptr), *m_event, m_handle);
+}
+
+} // namespace el
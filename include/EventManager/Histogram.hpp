@@ -0,0 +1,124 @@
+/*
+
+Log-linear latency histogram used by EventManager instrumentation and benchmarks
+https://github.com/3lyrion/EventManager
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+Copyright (c) 2025 3lyrion
+
+*/
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <limits>
+
+namespace el
+{
+
+// HDR-style histogram: every power of two is split into 16 linear sub-buckets,
+// so any recorded value is reported with a relative error below 1/16 (6.25%).
+// Recording is a bit scan and an increment, it never allocates.
+class Histogram
+{
+public:
+	static constexpr uint32_t SubBucketBits	= 4;
+	static constexpr uint32_t SubBuckets	= 1u << SubBucketBits;
+	static constexpr uint32_t BucketCount	= (64 - SubBucketBits + 1) * SubBuckets;
+
+	constexpr Histogram() = default;
+
+	constexpr void record(uint64_t value)
+	{
+		m_buckets[indexOf(value)]++;
+		m_count++;
+		m_sum += value;
+		m_min = std::min(m_min, value);
+		m_max = std::max(m_max, value);
+	}
+
+	constexpr void merge(Histogram const& other)
+	{
+		for (uint32_t i = 0; i < BucketCount; i++)
+			m_buckets[i] += other.m_buckets[i];
+
+		m_count += other.m_count;
+		m_sum   += other.m_sum;
+		m_min    = std::min(m_min, other.m_min);
+		m_max    = std::max(m_max, other.m_max);
+	}
+
+	constexpr void reset()
+	{
+		*this = Histogram();
+	}
+
+	constexpr uint64_t count() const { return m_count; }
+	constexpr uint64_t sum()   const { return m_sum; }
+	constexpr uint64_t min()   const { return m_count ? m_min : 0; }
+	constexpr uint64_t max()   const { return m_max; }
+
+	constexpr double mean() const
+	{
+		return m_count ? static_cast<double>(m_sum) / static_cast<double>(m_count) : 0.0;
+	}
+
+	// Value below which the given fraction (0..1) of the samples falls, e.g. 0.99 for p99
+	constexpr uint64_t percentile(double fraction) const
+	{
+		if (!m_count)
+			return 0;
+
+		if (fraction >= 1.0)
+			return m_max;
+
+		auto rank = static_cast<uint64_t>(fraction * static_cast<double>(m_count));
+		rank = std::min(rank + 1, m_count);
+
+		uint64_t seen = 0;
+		for (uint32_t i = 0; i < BucketCount; i++)
+		{
+			seen += m_buckets[i];
+			if (seen >= rank)
+				return std::clamp(highestOf(i), min(), m_max);
+		}
+
+		return m_max;
+	}
+
+private:
+	std::array<uint64_t, BucketCount> m_buckets{};
+
+	uint64_t m_count{};
+	uint64_t m_sum{};
+	uint64_t m_min = std::numeric_limits<uint64_t>::max();
+	uint64_t m_max{};
+
+	static constexpr uint32_t indexOf(uint64_t value)
+	{
+		if (value < SubBuckets)
+			return static_cast<uint32_t>(value);
+
+		uint32_t msb   = static_cast<uint32_t>(std::bit_width(value)) - 1;
+		uint32_t shift = msb - SubBucketBits;
+
+		return (shift + 1) * SubBuckets + static_cast<uint32_t>((value >> shift) & (SubBuckets - 1));
+	}
+
+	// Largest value that falls into the bucket
+	static constexpr uint64_t highestOf(uint32_t index)
+	{
+		if (index < SubBuckets)
+			return index;
+
+		uint32_t shift = index / SubBuckets - 1;
+		uint64_t base  = static_cast<uint64_t>(SubBuckets + index % SubBuckets) << shift;
+
+		return base + ((uint64_t{ 1 } << shift) - 1);
+	}
+};
+
+} // namespace el
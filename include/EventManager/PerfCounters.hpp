@@ -0,0 +1,270 @@
+/*
+
+Linux perf_event counters read around EventManager handler invocations
+https://github.com/3lyrion/EventManager
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+Copyright (c) 2025 3lyrion
+
+*/
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+
+#if defined(__linux__)
+	#include <linux/perf_event.h>
+	#include <sys/mman.h>
+	#include <sys/syscall.h>
+	#include <unistd.h>
+#endif
+
+namespace el
+{
+
+enum class PerfCounter : uint8_t
+{
+	// Hardware group
+	Instructions,
+	Cycles,
+	CacheMisses,
+	BranchMisses,
+
+	// Software group, used when hardware counters are unavailable (e.g. in VMs)
+	TaskClock,		// nanoseconds
+	PageFaults,
+
+	Count
+};
+
+constexpr size_t PerfCounterCount = static_cast<size_t>(PerfCounter::Count);
+
+using PerfValues = std::array<uint64_t, PerfCounterCount>;
+
+// Counter deltas accumulated over every measured call of one (event type, receiver type) pair
+struct PerfTotals
+{
+	uint64_t	calls{};
+	PerfValues	values{};
+
+	inline uint64_t operator [] (PerfCounter counter) const
+	{
+		return values[static_cast<size_t>(counter)];
+	}
+
+	inline void add(PerfValues const& before, PerfValues const& after)
+	{
+		calls++;
+
+		for (size_t i = 0; i < PerfCounterCount; i++)
+			values[i] += after[i] - before[i];
+	}
+};
+
+// One counter group per thread, opened on first use. Hardware counters are read with rdpmc
+// through the mmapped self-monitoring page when the kernel allows it (a few dozen cycles per
+// counter), otherwise the whole group is read with a single read() system call.
+class PerfCounters
+{
+public:
+	inline static PerfCounters& get()
+	{
+		static thread_local PerfCounters instance;
+		return instance;
+	}
+
+	PerfCounters(PerfCounters const&)				= delete;
+	PerfCounters& operator = (PerfCounters const&)	= delete;
+
+	// Whether the counter is measured on this thread
+	inline bool available(PerfCounter counter) const
+	{
+		return m_slots[static_cast<size_t>(counter)] >= 0;
+	}
+
+	// Whether the hardware group could be opened, false when running on software counters
+	inline bool hardware() const
+	{
+		return m_hardware;
+	}
+
+	inline void read(PerfValues& values) const
+	{
+#if defined(__linux__)
+		if (m_leader < 0)
+			return;
+
+	#if defined(__x86_64__) || defined(__i386__)
+		if (m_rdpmc)
+		{
+			for (size_t i = 0; i < PerfCounterCount; i++)
+				if (m_slots[i] >= 0)
+					values[i] = readMapped(m_pages[m_slots[i]]);
+
+			return;
+		}
+	#endif
+
+		// PERF_FORMAT_GROUP layout: nr, then one value per counter in opening order
+		uint64_t buffer[1 + MaxGroup]{};
+
+		if (::read(m_leader, buffer, sizeof(buffer)) <= 0)
+			return;
+
+		for (size_t i = 0; i < PerfCounterCount; i++)
+			if (m_slots[i] >= 0)
+				values[i] = buffer[1 + m_slots[i]];
+#else
+		(void)values;
+#endif
+	}
+
+private:
+	static constexpr size_t MaxGroup = 4;
+
+	std::array<int, PerfCounterCount>	m_slots;	// position in the group, -1 when unavailable
+	std::array<int, MaxGroup>			m_fds;
+	std::array<void*, MaxGroup>			m_pages{};
+	int									m_leader = -1;
+	bool								m_hardware{};
+	bool								m_rdpmc{};
+
+	PerfCounters()
+	{
+		m_slots.fill(-1);
+		m_fds.fill(-1);
+
+#if defined(__linux__)
+		m_hardware = openGroup({
+			std::pair{ PerfCounter::Cycles,			PERF_COUNT_HW_CPU_CYCLES },
+			std::pair{ PerfCounter::Instructions,	PERF_COUNT_HW_INSTRUCTIONS },
+			std::pair{ PerfCounter::CacheMisses,	PERF_COUNT_HW_CACHE_MISSES },
+			std::pair{ PerfCounter::BranchMisses,	PERF_COUNT_HW_BRANCH_MISSES }
+		}, PERF_TYPE_HARDWARE);
+
+		if (!m_hardware)
+		{
+			openGroup({
+				std::pair{ PerfCounter::TaskClock,	PERF_COUNT_SW_TASK_CLOCK },
+				std::pair{ PerfCounter::PageFaults,	PERF_COUNT_SW_PAGE_FAULTS }
+			}, PERF_TYPE_SOFTWARE);
+		}
+#endif
+	}
+
+	~PerfCounters()
+	{
+#if defined(__linux__)
+		for (size_t i = 0; i < MaxGroup; i++)
+		{
+			if (m_pages[i])
+				::munmap(m_pages[i], static_cast<size_t>(::sysconf(_SC_PAGESIZE)));
+
+			if (m_fds[i] >= 0)
+				::close(m_fds[i]);
+		}
+#endif
+	}
+
+#if defined(__linux__)
+	template <size_t N>
+	inline bool openGroup(std::pair<PerfCounter, int> const (&counters)[N], uint32_t type)
+	{
+		static_assert(N <= MaxGroup);
+
+		auto pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+
+		m_rdpmc = type == PERF_TYPE_HARDWARE;
+
+		int opened = 0;
+
+		for (size_t i = 0; i < N; i++)
+		{
+			perf_event_attr attr;
+			std::memset(&attr, 0, sizeof(attr));
+
+			attr.size			= sizeof(attr);
+			attr.type			= type;
+			attr.config			= static_cast<uint64_t>(counters[i].second);
+			attr.read_format	= PERF_FORMAT_GROUP;
+			attr.exclude_kernel	= 1;
+			attr.exclude_hv		= 1;
+
+			int fd = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, opened ? m_leader : -1, 0));
+			if (fd < 0)
+			{
+				if (!opened)
+					return false;
+
+				continue; // the group works without this counter
+			}
+
+			if (!opened)
+				m_leader = fd;
+
+			m_fds[opened]										= fd;
+			m_slots[static_cast<size_t>(counters[i].first)]	= opened;
+
+			if (m_rdpmc)
+			{
+				void* page = ::mmap(nullptr, pageSize, PROT_READ, MAP_SHARED, fd, 0);
+
+				if (page == MAP_FAILED)
+					m_rdpmc = false;
+				else
+				{
+					m_pages[opened] = page;
+					m_rdpmc        &= static_cast<perf_event_mmap_page*>(page)->cap_user_rdpmc != 0;
+				}
+			}
+
+			opened++;
+		}
+
+		return true;
+	}
+
+	#if defined(__x86_64__) || defined(__i386__)
+	static inline uint64_t readMapped(void* mapped)
+	{
+		auto page = static_cast<perf_event_mmap_page volatile*>(mapped);
+
+		uint32_t sequence;
+		uint64_t count;
+
+		do
+		{
+			sequence = page->lock;
+			asm volatile("" ::: "memory");
+
+			uint32_t index = page->index;
+			count          = page->offset;
+
+			if (index)
+			{
+				uint32_t low, high;
+				asm volatile("rdpmc" : "=a"(low), "=d"(high) : "c"(index - 1));
+
+				auto width  = page->pmc_width;
+				auto value  = static_cast<int64_t>((static_cast<uint64_t>(high) << 32) | low);
+
+				value <<= 64 - width;
+				value >>= 64 - width;
+
+				count += static_cast<uint64_t>(value);
+			}
+
+			asm volatile("" ::: "memory");
+		}
+		while (page->lock != sequence);
+
+		return count;
+	}
+	#endif
+#endif
+};
+
+} // namespace el
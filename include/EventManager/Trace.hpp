@@ -0,0 +1,299 @@
+/*
+
+Chrome Trace Event sink for EventManager dispatch spans
+https://github.com/3lyrion/EventManager
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+Copyright (c) 2025 3lyrion
+
+*/
+
+#pragma once
+
+#include "TypeName.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace el
+{
+
+enum class SpanKind : uint8_t
+{
+	Publish,		// the whole publish() call, nested publishes nest inside handler spans
+	Handler,		// a single handler invocation, named after the receiver type
+	UrgentActions,	// urgent actions executed at the start of a publish
+	EventActions	// event actions executed at the end of a publish
+};
+
+namespace internal
+{
+
+	struct TraceRecord
+	{
+		SpanKind				kind;
+		std::type_info const*	event;
+		std::type_info const*	receiver;	// handler spans only
+		uint64_t				begin;		// nanoseconds
+		uint64_t				end;
+	};
+
+	// Fixed-size ring owned by one thread, the oldest spans are overwritten when it is full
+	class TraceBuffer
+	{
+	public:
+		TraceBuffer(size_t capacity, uint32_t threadId) :
+			m_records(std::max<size_t>(capacity, 1)), m_threadId(threadId) { }
+
+		inline void push(TraceRecord const& record)
+		{
+			m_records[m_next] = record;
+
+			if (++m_next == m_records.size())
+			{
+				m_next    = 0;
+				m_wrapped = true;
+			}
+		}
+
+		inline std::vector<TraceRecord> records() const
+		{
+			if (!m_wrapped)
+				return { m_records.begin(), m_records.begin() + m_next };
+
+			std::vector<TraceRecord> result(m_records.begin() + m_next, m_records.end());
+			result.insert(result.end(), m_records.begin(), m_records.begin() + m_next);
+
+			return result;
+		}
+
+		inline uint32_t threadId() const
+		{
+			return m_threadId;
+		}
+
+	private:
+		std::vector<TraceRecord>	m_records;
+		size_t						m_next{};
+		bool						m_wrapped{};
+		uint32_t					m_threadId;
+	};
+
+} // namespace internal
+
+// Records dispatch spans into per-thread ring buffers and writes them as
+// Chrome Trace Event JSON (chrome://tracing, https://ui.perfetto.dev) when stopped.
+// Nothing is serialized or allocated per span while the session is running; a thread's ring
+// is allocated by start() or attachThread(), or else by the first span it records.
+class Tracer
+{
+public:
+	static constexpr size_t DefaultCapacity = 1 << 16;
+
+	Tracer() = delete;
+
+	// Start a new session with a ring of the given size per recording thread,
+	// the calling thread's ring is allocated here rather than inside its first publish
+	static inline void start(size_t recordsPerThread = DefaultCapacity)
+	{
+		{
+			std::lock_guard lock(state().mutex);
+
+			auto& s = state();
+			s.buffers.clear();
+			s.capacity = recordsPerThread;
+			s.session.fetch_add(1, std::memory_order_relaxed);
+			s.active.store(true, std::memory_order_release);
+		}
+
+		attachThread();
+	}
+
+	// Allocate the calling thread's ring for the running session,
+	// other publishing threads call this to keep the allocation out of dispatch
+	static inline void attachThread()
+	{
+		threadBuffer();
+	}
+
+	// Stop the session and write what was recorded.
+	// Publishing threads should be idle, their buffers are read without synchronization.
+	static inline void stop(std::ostream& out)
+	{
+		std::lock_guard lock(state().mutex);
+
+		auto& s = state();
+		s.active.store(false, std::memory_order_release);
+
+		write(out, s.buffers);
+
+		s.buffers.clear();
+		s.session.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	static inline bool active()
+	{
+		return state().active.load(std::memory_order_relaxed);
+	}
+
+	static inline void record(SpanKind kind, std::type_info const& event, std::type_info const* receiver, uint64_t begin, uint64_t end)
+	{
+		if (auto buffer = threadBuffer())
+			buffer->push({ kind, &event, receiver, begin, end });
+	}
+
+private:
+	using BufferPtr = std::shared_ptr<internal::TraceBuffer>;
+
+	struct State
+	{
+		std::mutex				mutex;
+		std::vector<BufferPtr>	buffers;
+		size_t					capacity = DefaultCapacity;
+		uint32_t				threads{};
+		std::atomic<uint64_t>	session{};
+		std::atomic<bool>		active{};
+	};
+
+	static inline State& state()
+	{
+		static State instance;
+		return instance;
+	}
+
+	static inline internal::TraceBuffer* threadBuffer()
+	{
+		struct Local
+		{
+			BufferPtr	buffer;
+			uint64_t	session = ~uint64_t{};
+			uint32_t	threadId{};
+		};
+
+		static thread_local Local local;
+
+		auto& s = state();
+		auto session = s.session.load(std::memory_order_relaxed);
+
+		if (local.session != session)
+		{
+			std::lock_guard lock(s.mutex);
+
+			if (!s.active.load(std::memory_order_relaxed))
+				return nullptr;
+
+			if (!local.threadId)
+				local.threadId = ++s.threads;
+
+			local.buffer  = std::make_shared<internal::TraceBuffer>(s.capacity, local.threadId);
+			local.session = s.session.load(std::memory_order_relaxed);
+
+			s.buffers.push_back(local.buffer);
+		}
+
+		return local.buffer.get();
+	}
+
+	static inline char const* kindName(SpanKind kind)
+	{
+		switch (kind)
+		{
+		case SpanKind::Publish:			return "publish";
+		case SpanKind::Handler:			return "handler";
+		case SpanKind::UrgentActions:	return "urgent actions";
+		case SpanKind::EventActions:	return "event actions";
+		}
+
+		return "";
+	}
+
+	static inline void writeString(std::ostream& out, std::string const& text)
+	{
+		out << '"';
+
+		for (char c : text)
+		{
+			if (c == '"' || c == '\\')
+				out << '\\';
+
+			out << c;
+		}
+
+		out << '"';
+	}
+
+	static inline void writeMicroseconds(std::ostream& out, uint64_t ns)
+	{
+		auto fraction = std::to_string(ns % 1000);
+
+		out << ns / 1000 << '.' << std::string(3 - fraction.size(), '0') << fraction;
+	}
+
+	static inline void write(std::ostream& out, std::vector<BufferPtr> const& buffers)
+	{
+		std::vector<std::pair<uint32_t, std::vector<internal::TraceRecord> > > threads;
+
+		uint64_t origin = ~uint64_t{};
+
+		for (auto& buffer : buffers)
+		{
+			auto records = buffer->records();
+
+			// Parents first, so viewers nest spans that share a start timestamp
+			std::sort(records.begin(), records.end(),
+				[](auto const& a, auto const& b)
+				{
+					return a.begin != b.begin ? a.begin < b.begin : a.end > b.end;
+				}
+			);
+
+			if (!records.empty())
+				origin = std::min(origin, records.front().begin);
+
+			threads.emplace_back(buffer->threadId(), std::move(records));
+		}
+
+		bool first = true;
+
+		out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+
+		for (auto& [threadId, records] : threads)
+		{
+			for (auto& record : records)
+			{
+				out << (first ? "\n" : ",\n");
+				first = false;
+
+				std::string name;
+
+				switch (record.kind)
+				{
+				case SpanKind::Publish:	name = typeName(*record.event);		break;
+				case SpanKind::Handler:	name = typeName(*record.receiver);	break;
+				default:				name = kindName(record.kind);		break;
+				}
+
+				out << "{\"name\":";
+				writeString(out, name);
+				out << ",\"cat\":\"" << kindName(record.kind) << "\",\"ph\":\"X\",\"ts\":";
+				writeMicroseconds(out, record.begin - origin);
+				out << ",\"dur\":";
+				writeMicroseconds(out, record.end - record.begin);
+				out << ",\"pid\":1,\"tid\":" << threadId << ",\"args\":{\"event\":";
+				writeString(out, typeName(*record.event));
+				out << "}}";
+			}
+		}
+
+		out << "\n]}\n";
+	}
+};
+
+} // namespace el
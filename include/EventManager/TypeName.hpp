@@ -0,0 +1,55 @@
+/*
+
+Readable type names for EventManager diagnostics
+https://github.com/3lyrion/EventManager
+
+Licensed under the MIT License <http://opensource.org/licenses/MIT>.
+Copyright (c) 2025 3lyrion
+
+*/
+
+#pragma once
+
+#include <string>
+#include <typeindex>
+#include <typeinfo>
+
+#if defined(__GNUG__) || defined(__clang__)
+	#include <cstdlib>
+	#include <cxxabi.h>
+#endif
+
+namespace el
+{
+
+// Demangled form of a std::type_info::name() (MSVC names are already readable).
+// Allocates, so keep it out of hot paths.
+inline std::string typeName(char const* name)
+{
+#if defined(__GNUG__) || defined(__clang__)
+	int   status    = 0;
+	char* demangled = abi::__cxa_demangle(name, nullptr, nullptr, &status);
+
+	if (status == 0 && demangled)
+	{
+		std::string result(demangled);
+		std::free(demangled);
+
+		return result;
+	}
+#endif
+
+	return name;
+}
+
+inline std::string typeName(std::type_info const& type)
+{
+	return typeName(type.name());
+}
+
+inline std::string typeName(std::type_index type)
+{
+	return typeName(type.name());
+}
+
+} // namespace el